@@ -0,0 +1,630 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "my_mat.h"
+
+/*
+ * Benchmark of the graph library.
+ *
+ * For every generator, size and density it builds a graph, then for every engine
+ * it times the load, the all pairs solve and the average query, checks the
+ * answers against a plain Floyd-Warshall (the oracle against its stretch bound
+ * on the undirected graph) and writes one CSV line.
+ *
+ * usage: bench_graph [-n 64,128,...] [-d 0.05,0.2,...] [-g random,grid,scalefree,complete]
+ *                    [-q queries] [-w max_weight] [-s seed] [-o file.csv]
+ */
+
+#define MAX_LIST 32
+#define MAX_CHECK_N 512 // bigger graphs are checked on a sample of the pairs
+
+//------------------------------------------------
+// Random numbers - xorshift64*, so runs are the same on every machine
+//------------------------------------------------
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t nextRandom()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+// uniform in [0, bound)
+static int randomBelow(int bound)
+{
+    return (int)(nextRandom() % (uint64_t)bound);
+}
+
+// uniform in [0, 1)
+static double randomUnit()
+{
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int randomWeight(int max_weight)
+{
+    return 1 + randomBelow(max_weight);
+}
+
+//------------------------------------------------
+// Graph generators - all fill an n * n matrix, 0 for no edge, and return
+// FALSE if they run out of memory
+//------------------------------------------------
+
+// every directed edge exists with probability density
+static int genRandom(int *mat, int n, double density, int max_weight)
+{
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            if (i != j && randomUnit() < density)
+                mat[(size_t)i * n + j] = randomWeight(max_weight);
+        }
+    }
+    return TRUE;
+}
+
+// a sqrt(n) x sqrt(n) lattice, every edge to a neighbour is kept with probability density
+static int genGrid(int *mat, int n, double density, int max_weight)
+{
+    int side = (int)ceil(sqrt((double)n));
+    for (int v = 0; v < n; v++)
+    {
+        int row = v / side;
+        int col = v % side;
+        int neighbours[4] = {
+            col + 1 < side ? v + 1 : -1,
+            col > 0 ? v - 1 : -1,
+            v + side,
+            row > 0 ? v - side : -1,
+        };
+        for (int k = 0; k < 4; k++)
+        {
+            int u = neighbours[k];
+            if (u >= 0 && u < n && randomUnit() < density)
+                mat[(size_t)v * n + u] = randomWeight(max_weight);
+        }
+    }
+    return TRUE;
+}
+
+// Barabasi-Albert - every new node links to about density * n / 2 nodes,
+// picked in proportion to their degree, in a random direction
+static int genScaleFree(int *mat, int n, double density, int max_weight)
+{
+    int m = (int)(density * n / 2);
+    if (m < 1)
+        m = 1;
+
+    // every edge end is written to ends[], so a uniform pick from it is a pick by degree
+    size_t max_ends = 2 * (size_t)n * m + 2;
+    int *ends = malloc(sizeof(int) * max_ends);
+    if (ends == NULL)
+        return FALSE;
+    size_t num_ends = 0;
+
+    for (int v = 1; v < n; v++)
+    {
+        int links = v < m ? v : m;
+        for (int e = 0; e < links; e++)
+        {
+            int u = num_ends == 0 ? 0 : ends[nextRandom() % num_ends];
+            if (u == v)
+                continue;
+
+            if (nextRandom() & 1)
+                mat[(size_t)v * n + u] = randomWeight(max_weight);
+            else
+                mat[(size_t)u * n + v] = randomWeight(max_weight);
+
+            ends[num_ends++] = u;
+            ends[num_ends++] = v;
+        }
+    }
+    free(ends);
+    return TRUE;
+}
+
+// every directed edge, density is ignored
+static int genComplete(int *mat, int n, double density, int max_weight)
+{
+    (void)density;
+    return genRandom(mat, n, 1.0, max_weight);
+}
+
+typedef struct
+{
+    const char *name;
+    int (*generate)(int *mat, int n, double density, int max_weight);
+} Generator;
+
+static const Generator generators[] = {
+    {"random", genRandom},
+    {"grid", genGrid},
+    {"scalefree", genScaleFree},
+    {"complete", genComplete},
+};
+#define NUM_GENERATORS (int)(sizeof(generators) / sizeof(generators[0]))
+
+//------------------------------------------------
+// Reference - the original Floyd-Warshall, on long long with 0 for no path
+//------------------------------------------------
+
+static void referenceFloydWarshall(const int *mat, int n, long long *dist)
+{
+    for (size_t i = 0; i < (size_t)n * n; i++)
+    {
+        dist[i] = mat[i];
+    }
+    for (int i = 0; i < n; i++)
+    {
+        dist[(size_t)i * n + i] = 0;
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            long long ik = dist[(size_t)i * n + k];
+            if (i == k || ik == 0)
+                continue;
+            for (int j = 0; j < n; j++)
+            {
+                long long kj = dist[(size_t)k * n + j];
+                long long *ij = &dist[(size_t)i * n + j];
+                if (i == j || kj == 0)
+                    continue;
+                if (*ij == 0 || ik + kj < *ij)
+                    *ij = ik + kj;
+            }
+        }
+    }
+}
+
+//------------------------------------------------
+// Engines
+//------------------------------------------------
+
+// the reference answers of one graph - dist is directed, undirected_dist uses
+// every edge both ways (for the oracle)
+typedef struct
+{
+    const long long *dist;
+    const long long *undirected_dist;
+    int n;
+} Reference;
+
+typedef struct
+{
+    const char *name;
+    // builds the engine from the matrix, NULL if there is not enough memory
+    void *(*load)(const int *mat, int n);
+    void (*solve)(void *engine);
+    long long (*query)(void *engine, int start, int end);
+    // TRUE if answer is right for the query by the reference
+    int (*check)(void *engine, long long answer, const Reference *reference, int start, int end);
+    void (*release)(void *engine);
+} Engine;
+
+static void *loadGraph(const int *mat, int n)
+{
+    Graph *graph = Graph_alloc(n, NULL);
+    if (graph != NULL && Graph_load(graph, mat) == FALSE)
+    {
+        Graph_free(graph);
+        return NULL;
+    }
+    return graph;
+}
+
+static void releaseGraph(void *engine)
+{
+    Graph_free(engine);
+}
+
+static void solveFloyd(void *engine)
+{
+    Graph_solve(engine);
+}
+
+static void solveClosure(void *engine)
+{
+    Graph_setReachEngine(engine, REACH_CLOSURE);
+    Graph_solveReach(engine);
+}
+
+static void solveScc(void *engine)
+{
+    Graph_setReachEngine(engine, REACH_SCC);
+    Graph_solveReach(engine);
+}
+
+static long long queryDistance(void *engine, int start, int end)
+{
+    return Graph_shortestPath(engine, start, end);
+}
+
+static long long queryReach(void *engine, int start, int end)
+{
+    return Graph_isPathExists(engine, start, end);
+}
+
+// the exact distance, -1 for no path
+static long long expectedDistance(const Reference *reference, int start, int end)
+{
+    long long dist = reference->dist[(size_t)start * reference->n + end];
+    return start == end || dist == 0 ? -1 : dist;
+}
+
+static int checkDistance(void *engine, long long answer, const Reference *reference, int start, int end)
+{
+    (void)engine;
+    return answer == expectedDistance(reference, start, end);
+}
+
+static int checkReach(void *engine, long long answer, const Reference *reference, int start, int end)
+{
+    (void)engine;
+    return answer == (expectedDistance(reference, start, end) != -1 ? TRUE : FALSE);
+}
+
+// the tiled engine keeps its distances in this file while it runs
+#define TILES_PATH "bench_graph.tiles"
+#define TILES_TILE 64
+
+static void *loadTiled(const int *mat, int n)
+{
+    TiledGraph *tiled = TiledGraph_alloc(TILES_PATH, n, TILES_TILE);
+    for (int i = 0; tiled != NULL && i < n; i++)
+    {
+        if (TiledGraph_setRow(tiled, i, mat + (size_t)i * n) == FALSE)
+        {
+            TiledGraph_free(tiled);
+            tiled = NULL;
+        }
+    }
+    if (tiled == NULL)
+        unlink(TILES_PATH);
+    return tiled;
+}
+
+static void solveTiled(void *engine)
+{
+    TiledGraph_solve(engine);
+}
+
+static long long queryTiled(void *engine, int start, int end)
+{
+    return TiledGraph_shortestPath(engine, start, end);
+}
+
+static void releaseTiled(void *engine)
+{
+    TiledGraph_free(engine);
+    unlink(TILES_PATH);
+}
+
+// the levels of the oracle, its answers are at most 2k - 1 times the distance
+#define ORACLE_K 2
+
+static void *loadOracle(const int *mat, int n)
+{
+    size_t num_edges = 0;
+    for (size_t i = 0; i < (size_t)n * n; i++)
+    {
+        num_edges += mat[i] != 0;
+    }
+    if (num_edges > INT_MAX)
+        return NULL;
+
+    GraphEdge *edges = malloc(sizeof(GraphEdge) * (num_edges + 1));
+    if (edges == NULL)
+        return NULL;
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            if (i != j && mat[(size_t)i * n + j] != 0)
+            {
+                edges[count].from = i;
+                edges[count].to = j;
+                edges[count].weight = mat[(size_t)i * n + j];
+                count++;
+            }
+        }
+    }
+    DistanceOracle *oracle = DistanceOracle_alloc(n, count, edges, ORACLE_K, 1);
+    free(edges);
+    return oracle;
+}
+
+// the oracle builds everything in load
+static void solveOracle(void *engine)
+{
+    (void)engine;
+}
+
+static long long queryOracle(void *engine, int start, int end)
+{
+    return DistanceOracle_query(engine, start, end);
+}
+
+// the oracle is right if it is between the undirected distance and stretch times it
+static int checkOracle(void *engine, long long answer, const Reference *reference, int start, int end)
+{
+    long long dist = reference->undirected_dist[(size_t)start * reference->n + end];
+    if (start == end || dist == 0)
+        return answer == -1;
+    return answer >= dist && answer <= dist * DistanceOracle_stretch(engine);
+}
+
+static void releaseOracle(void *engine)
+{
+    DistanceOracle_free(engine);
+}
+
+static const Engine engines[] = {
+    {"floyd", loadGraph, solveFloyd, queryDistance, checkDistance, releaseGraph},
+    {"closure", loadGraph, solveClosure, queryReach, checkReach, releaseGraph},
+    {"scc", loadGraph, solveScc, queryReach, checkReach, releaseGraph},
+    {"tiled", loadTiled, solveTiled, queryTiled, checkDistance, releaseTiled},
+    {"oracle", loadOracle, solveOracle, queryOracle, checkOracle, releaseOracle},
+};
+#define NUM_ENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+//------------------------------------------------
+// Benchmark
+//------------------------------------------------
+
+static double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// compares the engine with the reference - every pair, or a sample on big graphs
+static int checkEngine(const Engine *engine, void *loaded, const Reference *reference)
+{
+    int n = reference->n;
+    if (n <= MAX_CHECK_N)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                if (engine->check(loaded, engine->query(loaded, i, j), reference, i, j) == FALSE)
+                    return FALSE;
+            }
+        }
+        return TRUE;
+    }
+
+    for (int q = 0; q < MAX_CHECK_N * MAX_CHECK_N; q++)
+    {
+        int i = randomBelow(n);
+        int j = randomBelow(n);
+        if (engine->check(loaded, engine->query(loaded, i, j), reference, i, j) == FALSE)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// the matrix with every edge both ways - the lighter one where both directions have one
+static void undirectedMatrix(const int *mat, int n, int *undirected)
+{
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            int ij = mat[(size_t)i * n + j];
+            int ji = mat[(size_t)j * n + i];
+            undirected[(size_t)i * n + j] = ij == 0 ? ji : ji == 0 || ij < ji ? ij : ji;
+        }
+    }
+}
+
+// returns how many engines did not match the reference
+static int benchOne(FILE *out, const Generator *generator, int n, double density,
+                     int queries, int max_weight)
+{
+    int *mat = calloc((size_t)n * n, sizeof(int));
+    int *undirected = malloc(sizeof(int) * n * n);
+    long long *dist = malloc(sizeof(long long) * n * n);
+    long long *undirected_dist = malloc(sizeof(long long) * n * n);
+    int *starts = malloc(sizeof(int) * queries);
+    int *ends = malloc(sizeof(int) * queries);
+    if (mat == NULL || undirected == NULL || dist == NULL || undirected_dist == NULL ||
+        starts == NULL || ends == NULL || generator->generate(mat, n, density, max_weight) == FALSE)
+    {
+        fprintf(stderr, "bench: out of memory for n=%d\n", n);
+        free(mat);
+        free(undirected);
+        free(dist);
+        free(undirected_dist);
+        free(starts);
+        free(ends);
+        return 1;
+    }
+
+    size_t edges = 0;
+    for (size_t i = 0; i < (size_t)n * n; i++)
+    {
+        edges += mat[i] != 0;
+    }
+
+    double start_time = nowSeconds();
+    referenceFloydWarshall(mat, n, dist);
+    double reference_seconds = nowSeconds() - start_time;
+
+    // the oracle is checked against the distances of the undirected graph
+    undirectedMatrix(mat, n, undirected);
+    referenceFloydWarshall(undirected, n, undirected_dist);
+    Reference reference = {dist, undirected_dist, n};
+
+    for (int q = 0; q < queries; q++)
+    {
+        starts[q] = randomBelow(n);
+        ends[q] = randomBelow(n);
+    }
+
+    int failed = 0;
+    for (int e = 0; e < NUM_ENGINES; e++)
+    {
+        const Engine *engine = &engines[e];
+
+        start_time = nowSeconds();
+        void *loaded = engine->load(mat, n);
+        double load_seconds = nowSeconds() - start_time;
+        if (loaded == NULL)
+        {
+            fprintf(stderr, "bench: %s is out of memory for n=%d\n", engine->name, n);
+            failed++;
+            continue;
+        }
+
+        start_time = nowSeconds();
+        engine->solve(loaded);
+        double solve_seconds = nowSeconds() - start_time;
+
+        // the checksum keeps the compiler from dropping the queries
+        long long checksum = 0;
+        start_time = nowSeconds();
+        for (int q = 0; q < queries; q++)
+        {
+            checksum += engine->query(loaded, starts[q], ends[q]);
+        }
+        double query_seconds = nowSeconds() - start_time;
+
+        int ok = checkEngine(engine, loaded, &reference);
+
+        fprintf(out, "%s,%d,%.4f,%zu,%s,%.6f,%.6f,%.6f,%.1f,%lld,%s\n",
+                generator->name, n, density, edges, engine->name,
+                load_seconds * 1e3, solve_seconds * 1e3, reference_seconds * 1e3,
+                queries > 0 ? query_seconds * 1e9 / queries : 0.0, checksum,
+                ok ? "ok" : "MISMATCH");
+        fflush(out);
+
+        failed += !ok;
+        if (!ok)
+            fprintf(stderr, "bench: %s on %s n=%d density=%.4f does not match the reference\n",
+                    engine->name, generator->name, n, density);
+
+        engine->release(loaded);
+    }
+
+    free(mat);
+    free(undirected);
+    free(dist);
+    free(undirected_dist);
+    free(starts);
+    free(ends);
+    return failed;
+}
+
+//------------------------------------------------
+// Command line
+//------------------------------------------------
+
+// parses "a,b,c" into values, returns how many there are
+static int parseList(const char *text, double values[MAX_LIST])
+{
+    int count = 0;
+    const char *p = text;
+    while (*p != '\0' && count < MAX_LIST)
+    {
+        char *after;
+        values[count++] = strtod(p, &after);
+        if (after == p)
+            return -1;
+        p = *after == ',' ? after + 1 : after;
+    }
+    return count;
+}
+
+static int usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n 64,128,...] [-d 0.05,0.2,...] [-g random,grid,scalefree,complete]\n"
+            "          [-q queries] [-w max_weight] [-s seed] [-o file.csv]\n",
+            name);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    double sizes[MAX_LIST] = {64, 128, 256, 512};
+    int num_sizes = 4;
+    double densities[MAX_LIST] = {0.01, 0.1, 0.5};
+    int num_densities = 3;
+    const char *generator_names = "random,grid,scalefree,complete";
+    int queries = 100000;
+    int max_weight = 100;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            return usage(argv[0]);
+
+        if (strcmp(argv[i], "-n") == 0)
+            num_sizes = parseList(argv[++i], sizes);
+        else if (strcmp(argv[i], "-d") == 0)
+            num_densities = parseList(argv[++i], densities);
+        else if (strcmp(argv[i], "-g") == 0)
+            generator_names = argv[++i];
+        else if (strcmp(argv[i], "-q") == 0)
+            queries = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0)
+            max_weight = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0)
+            rng_state = strtoull(argv[++i], NULL, 10) | 1;
+        else if (strcmp(argv[i], "-o") == 0)
+            out_path = argv[++i];
+        else
+            return usage(argv[0]);
+    }
+    if (num_sizes <= 0 || num_densities <= 0 || queries < 0 || max_weight < 1)
+        return usage(argv[0]);
+
+    FILE *out = out_path == NULL ? stdout : fopen(out_path, "w");
+    if (out == NULL)
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    fprintf(out, "generator,n,density,edges,engine,load_ms,solve_ms,reference_ms,query_ns,checksum,check\n");
+
+    int failed = 0;
+    for (int g = 0; g < NUM_GENERATORS; g++)
+    {
+        // only the generators that were asked for
+        const char *found = strstr(generator_names, generators[g].name);
+        size_t len = strlen(generators[g].name);
+        if (found == NULL || (found[len] != '\0' && found[len] != ','))
+            continue;
+
+        for (int s = 0; s < num_sizes; s++)
+        {
+            for (int d = 0; d < num_densities; d++)
+            {
+                failed += benchOne(out, &generators[g], (int)sizes[s], densities[d], queries, max_weight);
+            }
+        }
+    }
+
+    if (out != stdout)
+        fclose(out);
+    return failed != 0 ? 1 : 0;
+}
@@ -0,0 +1,722 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "my_knap.h"
+
+/*
+ * Benchmark of the knapsack library.
+ *
+ * For every instance class, number of items and capacity percent it generates
+ * an instance of Pisinger's classes. Like him it sets the capacity to that
+ * percent of the instance's total weight, so it grows with n and the range.
+ *
+ * Every engine runs in a child process, so a run that takes too long can be
+ * stopped. The peak memory is what the child grew by over the pages it got
+ * from the fork. The bench checks the selection of every engine, that the
+ * exact ones all found the same value, and that KNAP_FPTAS found at least
+ * (1 - epsilon) of it, then writes one CSV line per engine.
+ * On the instances small enough for them it also runs the incremental
+ * knapsacks - "stack" pushes, pops and takes out items of a KnapStack and
+ * "ops" runs a stream of adds, removes and queries through Knapsack_solveOps -
+ * and checks every answer against Knapsack_solve on the items there are then.
+ * cells_per_s is n * (capacity + 1) per second - the cells of the dp table
+ * the engine stands in for, so the engines can be compared.
+ *
+ * usage: bench_knap [-n 40,1000,...] [-w 10,50,...]
+ *                   [-c uncorrelated,weak,strong,inverse,subset,spanner]
+ *                   [-e auto,dp,value,bnb,mitm,pareto,fptas,stack,ops]
+ *                   [-r range] [-l seconds] [-x] [-s seed] [-o file.csv]
+ * -w takes the capacities as percents of the total weight.
+ */
+
+#define MAX_LIST 32
+
+// the spanner instances - SPANNER_SIZE items, multiplied by up to SPANNER_MULTIPLIER
+#define SPANNER_SIZE 2
+#define SPANNER_MULTIPLIER 10
+
+// the epsilon KNAP_FPTAS runs with
+#define FPTAS_EPSILON 0.1
+
+// the incremental knapsacks run on the instances of at most this many dp cells
+// (a KnapStack keeps a row per item), with INCREMENTAL_OPS ops per item
+#define INCREMENTAL_CELLS (1 << 24)
+#define INCREMENTAL_OPS 4
+
+//------------------------------------------------
+// Random numbers - xorshift64*, so runs are the same on every machine
+//------------------------------------------------
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t nextRandom()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+// uniform in [lo, hi]
+static long long randomBetween(long long lo, long long hi)
+{
+    return lo + (long long)(nextRandom() % (uint64_t)(hi - lo + 1));
+}
+
+//------------------------------------------------
+// Instance classes - all fill n weights and values from [1, range]
+//------------------------------------------------
+
+static void genUncorrelated(long long *weights, long long *values, int n, long long range)
+{
+    for (int i = 0; i < n; i++)
+    {
+        weights[i] = randomBetween(1, range);
+        values[i] = randomBetween(1, range);
+    }
+}
+
+// the value within range / 10 of the weight
+static void genWeak(long long *weights, long long *values, int n, long long range)
+{
+    for (int i = 0; i < n; i++)
+    {
+        weights[i] = randomBetween(1, range);
+        values[i] = randomBetween(weights[i] - range / 10, weights[i] + range / 10);
+        if (values[i] < 1)
+            values[i] = 1;
+    }
+}
+
+// the value is the weight + range / 10
+static void genStrong(long long *weights, long long *values, int n, long long range)
+{
+    for (int i = 0; i < n; i++)
+    {
+        weights[i] = randomBetween(1, range);
+        values[i] = weights[i] + range / 10;
+    }
+}
+
+// the weight is the value + range / 10
+static void genInverse(long long *weights, long long *values, int n, long long range)
+{
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = randomBetween(1, range);
+        weights[i] = values[i] + range / 10;
+    }
+}
+
+// the value is the weight
+static void genSubset(long long *weights, long long *values, int n, long long range)
+{
+    for (int i = 0; i < n; i++)
+    {
+        weights[i] = randomBetween(1, range);
+        values[i] = weights[i];
+    }
+}
+
+// a few strongly correlated items, scaled down, and every item one of them
+// times a random multiplier
+static void genSpanner(long long *weights, long long *values, int n, long long range)
+{
+    long long span_weights[SPANNER_SIZE];
+    long long span_values[SPANNER_SIZE];
+    genStrong(span_weights, span_values, SPANNER_SIZE, range);
+    for (int k = 0; k < SPANNER_SIZE; k++)
+    {
+        span_weights[k] = (2 * span_weights[k] + SPANNER_MULTIPLIER - 1) / SPANNER_MULTIPLIER;
+        span_values[k] = (2 * span_values[k] + SPANNER_MULTIPLIER - 1) / SPANNER_MULTIPLIER;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int k = (int)randomBetween(0, SPANNER_SIZE - 1);
+        long long multiplier = randomBetween(1, SPANNER_MULTIPLIER);
+        weights[i] = multiplier * span_weights[k];
+        values[i] = multiplier * span_values[k];
+    }
+}
+
+typedef struct
+{
+    const char *name;
+    void (*generate)(long long *weights, long long *values, int n, long long range);
+} InstanceClass;
+
+static const InstanceClass classes[] = {
+    {"uncorrelated", genUncorrelated},
+    {"weak", genWeak},
+    {"strong", genStrong},
+    {"inverse", genInverse},
+    {"subset", genSubset},
+    {"spanner", genSpanner},
+};
+#define NUM_CLASSES (int)(sizeof(classes) / sizeof(classes[0]))
+
+// epsilon is how far below the optimum the engine may be, 0 for the exact ones
+typedef struct
+{
+    const char *name;
+    int engine;
+    double epsilon;
+} Engine;
+
+static const Engine engines[] = {
+    {"auto", KNAP_AUTO, 0},
+    {"dp", KNAP_DP, 0},
+    {"value", KNAP_VALUE_DP, 0},
+    {"bnb", KNAP_BNB, 0},
+    {"mitm", KNAP_MITM, 0},
+    {"pareto", KNAP_PARETO, 0},
+    {"fptas", KNAP_FPTAS, FPTAS_EPSILON},
+};
+#define NUM_ENGINES (int)(sizeof(engines) / sizeof(engines[0]))
+
+//------------------------------------------------
+// Benchmark
+//------------------------------------------------
+
+// what a child tells its parent about its run
+typedef struct
+{
+    long long max_value;
+    double seconds;
+    int feasible;
+    long peak_kb;
+} RunResult;
+
+// the state of a run in the CSV
+#define RUN_OK 0
+#define RUN_FAILED 1   // the engine returned -1 - out of memory or too many items
+#define RUN_TIMEOUT 2
+#define RUN_CRASHED 3
+
+static double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the child's side - solves and writes a RunResult to fd
+static void runChild(int fd, const Engine *engine, int n, const long long *weights, const long long *values,
+                     long long capacity, int reduce, int seconds)
+{
+    // the peak of a forked child starts at its parent's resident pages - only
+    // what it grows by on top of them is the run's
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long base_kb = usage.ru_maxrss;
+
+    alarm(seconds);
+    RunResult result = {-1, 0, FALSE, 0};
+    Knapsack *knap = Knapsack_alloc();
+    int *selected = malloc(sizeof(int) * (n + 1));
+    if (knap != NULL && selected != NULL)
+    {
+        Knapsack_setEngine(knap, engine->engine);
+        Knapsack_setReduce(knap, reduce);
+        if (engine->epsilon > 0)
+            Knapsack_setEpsilon(knap, engine->epsilon);
+        double start_time = nowSeconds();
+        result.max_value = Knapsack_solve(knap, n, weights, values, capacity, selected);
+        result.seconds = nowSeconds() - start_time;
+
+        // the selection has to weigh at most the capacity and be worth max_value
+        long long weight = 0;
+        long long value = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (selected[i] == TRUE)
+            {
+                weight += weights[i];
+                value += values[i];
+            }
+        }
+        result.feasible = weight <= capacity && value == result.max_value;
+    }
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_kb = usage.ru_maxrss - base_kb;
+    if (write(fd, &result, sizeof(result)) != sizeof(result))
+        _exit(1);
+    _exit(0);
+}
+
+// runs one engine in a child, returns one of RUN_ and fills result (a peak of 0 if it didn't finish)
+static int runEngine(const Engine *engine, int n, const long long *weights, const long long *values,
+                     long long capacity, int reduce, int seconds, RunResult *result)
+{
+    RunResult none = {-1, 0, FALSE, 0};
+    *result = none;
+    int fds[2];
+    if (pipe(fds) != 0)
+        return RUN_CRASHED;
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return RUN_CRASHED;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        runChild(fds[1], engine, n, weights, values, capacity, reduce, seconds);
+    }
+
+    close(fds[1]);
+    ssize_t got = read(fds[0], result, sizeof(RunResult));
+    close(fds[0]);
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0)
+        return RUN_CRASHED;
+
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+        return RUN_TIMEOUT;
+    if (got != sizeof(RunResult) || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return RUN_CRASHED;
+    return result->max_value < 0 ? RUN_FAILED : RUN_OK;
+}
+
+// whether name is one of the names of the list "a,b,c" - every place it is
+// found is tried, as it can be a part of a longer name first
+static int inList(const char *list, const char *name)
+{
+    size_t len = strlen(name);
+    for (const char *found = strstr(list, name); found != NULL; found = strstr(found + 1, name))
+    {
+        if ((found == list || found[-1] == ',') && (found[len] == '\0' || found[len] == ','))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// the best value of the items within capacity, with Knapsack_solve - what the
+// incremental knapsacks are checked against
+static long long solveLive(Knapsack *knap, int *selected, int n, const long long *weights,
+                           const long long *values, long long capacity)
+{
+    return Knapsack_solve(knap, n, weights, values, capacity, selected);
+}
+
+/*
+ * KnapStack - items of the instance are pushed, popped and taken out at random,
+ * and after every op the best value and the selection of a random capacity are
+ * checked. live_weights / live_values mirror the stack, in its order.
+ * Returns how many answers were wrong, -1 if there is not enough memory.
+ */
+static int checkStack(Knapsack *knap, int n, const long long *weights, const long long *values,
+                      long long capacity, long long *live_weights, long long *live_values, int *selected,
+                      long long *last, double *seconds)
+{
+    KnapStack *stack = KnapStack_alloc(capacity);
+    if (stack == NULL)
+        return -1;
+
+    int wrong = 0;
+    int size = 0;
+    int next = 0;
+    for (int op = 0; op < INCREMENTAL_OPS * n; op++)
+    {
+        // more pushes than pops, so the stack grows to about half the items
+        int kind = size == 0 ? 0 : (int)randomBetween(0, 3);
+        double start_time = nowSeconds();
+        int ok = TRUE;
+        if (kind <= 1 && size < n)
+        {
+            ok = KnapStack_push(stack, weights[next], values[next]);
+            live_weights[size] = weights[next];
+            live_values[size] = values[next];
+            size++;
+            next = (next + 1) % n;
+        }
+        else if (kind == 2)
+        {
+            KnapStack_pop(stack);
+            size--;
+        }
+        else
+        {
+            int index = (int)randomBetween(0, size - 1);
+            ok = KnapStack_remove(stack, index);
+            memmove(live_weights + index, live_weights + index + 1, sizeof(long long) * (size - index - 1));
+            memmove(live_values + index, live_values + index + 1, sizeof(long long) * (size - index - 1));
+            size--;
+        }
+        long long limit = randomBetween(0, capacity);
+        long long best = KnapStack_select(stack, limit, selected);
+        *seconds += nowSeconds() - start_time;
+        if (!ok)
+        {
+            KnapStack_free(stack);
+            return -1;
+        }
+
+        // the selection is of the items on the stack, within limit and worth best
+        long long weight = 0;
+        long long value = 0;
+        for (int i = 0; i < size; i++)
+        {
+            if (selected[i] == TRUE)
+            {
+                weight += live_weights[i];
+                value += live_values[i];
+            }
+        }
+        long long expected = solveLive(knap, selected, size, live_weights, live_values, limit);
+        wrong += KnapStack_size(stack) != size || best != expected || weight > limit || value != best;
+        *last = best;
+    }
+    KnapStack_free(stack);
+    return wrong;
+}
+
+/*
+ * Knapsack_solveOps - a stream of adds of the instance's items, removes of
+ * items still there and queries of random capacities, then every answer is
+ * checked against the items there were at its query.
+ * Returns how many answers were wrong, -1 if there is not enough memory.
+ */
+static int checkOps(Knapsack *knap, int n, const long long *weights, const long long *values,
+                    long long capacity, long long *live_weights, long long *live_values, int *selected,
+                    long long *last, double *seconds)
+{
+    int count = INCREMENTAL_OPS * n;
+    KnapOp *ops = malloc(sizeof(KnapOp) * count);
+    int *live = malloc(sizeof(int) * count);
+    if (ops == NULL || live == NULL)
+    {
+        free(ops);
+        free(live);
+        return -1;
+    }
+
+    // live holds the ops of the items that are there
+    int num_live = 0;
+    int next = 0;
+    for (int t = 0; t < count; t++)
+    {
+        int kind = num_live == 0 ? 0 : (int)randomBetween(0, 4);
+        memset(&ops[t], 0, sizeof(KnapOp));
+        if (kind <= 1)
+        {
+            ops[t].type = KNAP_ADD;
+            ops[t].weight = weights[next];
+            ops[t].value = values[next];
+            next = (next + 1) % n;
+            live[num_live++] = t;
+        }
+        else if (kind == 2)
+        {
+            int k = (int)randomBetween(0, num_live - 1);
+            ops[t].type = KNAP_REMOVE;
+            ops[t].item = live[k];
+            live[k] = live[--num_live];
+        }
+        else
+        {
+            ops[t].type = KNAP_QUERY;
+            ops[t].capacity = randomBetween(0, capacity);
+        }
+    }
+
+    double start_time = nowSeconds();
+    int ok = Knapsack_solveOps(knap, capacity, ops, count);
+    *seconds += nowSeconds() - start_time;
+
+    // the same stream again, with the items there are at every query
+    int wrong = 0;
+    num_live = 0;
+    for (int t = 0; t < count && ok; t++)
+    {
+        if (ops[t].type == KNAP_ADD)
+        {
+            live[num_live++] = t;
+        }
+        else if (ops[t].type == KNAP_REMOVE)
+        {
+            for (int k = 0; k < num_live; k++)
+            {
+                if (live[k] == ops[t].item)
+                {
+                    live[k] = live[--num_live];
+                    break;
+                }
+            }
+        }
+        else
+        {
+            for (int k = 0; k < num_live; k++)
+            {
+                live_weights[k] = ops[live[k]].weight;
+                live_values[k] = ops[live[k]].value;
+            }
+            wrong += ops[t].answer != solveLive(knap, selected, num_live, live_weights, live_values,
+                                                ops[t].capacity);
+            *last = ops[t].answer;
+        }
+    }
+    free(ops);
+    free(live);
+    return ok ? wrong : -1;
+}
+
+// runs "stack" and "ops" on the instance if they were asked for and it is small
+// enough, returns how many of them had a wrong answer
+static int benchIncremental(FILE *out, const InstanceClass *instance_class, int n, long long percent,
+                            long long capacity, long long range, const char *engine_names,
+                            const long long *weights, const long long *values)
+{
+    static const char *names[] = {"stack", "ops"};
+    int failed = 0;
+    for (int e = 0; e < 2; e++)
+    {
+        if (!inList(engine_names, names[e]) || (double)(n + 1) * (capacity + 1) > INCREMENTAL_CELLS)
+            continue;
+
+        Knapsack *knap = Knapsack_alloc();
+        long long *live_weights = malloc(sizeof(long long) * (INCREMENTAL_OPS * n + 1));
+        long long *live_values = malloc(sizeof(long long) * (INCREMENTAL_OPS * n + 1));
+        int *selected = malloc(sizeof(int) * (INCREMENTAL_OPS * n + 1));
+        long long last = -1;
+        double seconds = 0;
+        int wrong = -1;
+        if (knap != NULL && live_weights != NULL && live_values != NULL && selected != NULL)
+        {
+            wrong = e == 0 ? checkStack(knap, n, weights, values, capacity, live_weights, live_values, selected,
+                                        &last, &seconds)
+                           : checkOps(knap, n, weights, values, capacity, live_weights, live_values, selected,
+                                      &last, &seconds);
+        }
+        Knapsack_free(knap);
+        free(live_weights);
+        free(live_values);
+        free(selected);
+
+        const char *check = wrong < 0 ? "failed" : (wrong > 0 ? "MISMATCH" : "ok");
+        if (wrong > 0)
+        {
+            failed++;
+            fprintf(stderr, "bench: %s on %s n=%d capacity=%lld gave %d wrong answers\n",
+                    names[e], instance_class->name, n, capacity, wrong);
+        }
+        // the peak memory and the cells are not measured for them
+        fprintf(out, "%s,%d,%lld,%lld,%lld,%s,%s,%lld,%.3f,%ld,%.3e,%s\n",
+                instance_class->name, n, percent, capacity, range, names[e], "no",
+                last, seconds * 1e3, 0L, 0.0, check);
+        fflush(out);
+    }
+    return failed;
+}
+
+// returns how many engines did not find a valid selection, or the best value of the exact
+// ones (at least 1 - epsilon of it for the others)
+static int benchOne(FILE *out, const InstanceClass *instance_class, int n, long long percent, long long range,
+                    const char *engine_names, int reduce, int seconds)
+{
+    long long *weights = malloc(sizeof(long long) * (n + 1));
+    long long *values = malloc(sizeof(long long) * (n + 1));
+    if (weights == NULL || values == NULL)
+    {
+        fprintf(stderr, "bench: out of memory for n=%d\n", n);
+        free(weights);
+        free(values);
+        return 1;
+    }
+    instance_class->generate(weights, values, n, range);
+    long long total_weight = 0;
+    for (int i = 0; i < n; i++)
+    {
+        total_weight += weights[i];
+    }
+    long long capacity = (long long)((__int128)total_weight * percent / 100);
+
+    RunResult results[NUM_ENGINES];
+    int states[NUM_ENGINES];
+    int ran[NUM_ENGINES];
+    long long best = -1;
+    for (int e = 0; e < NUM_ENGINES; e++)
+    {
+        // only the engines that were asked for
+        ran[e] = inList(engine_names, engines[e].name);
+        if (!ran[e])
+            continue;
+
+        states[e] = runEngine(&engines[e], n, weights, values, capacity, reduce, seconds, &results[e]);
+        if (states[e] == RUN_OK && engines[e].epsilon == 0 && results[e].max_value > best)
+            best = results[e].max_value;
+    }
+
+    static const char *state_names[] = {"ok", "failed", "timeout", "crashed"};
+    int failed = 0;
+    for (int e = 0; e < NUM_ENGINES; e++)
+    {
+        if (!ran[e])
+            continue;
+
+        const char *check = state_names[states[e]];
+        double ms = 0;
+        double cells_per_s = 0;
+        long long max_value = -1;
+        if (states[e] == RUN_OK)
+        {
+            // with no exact engine to go by only the selection is checked
+            long long value = results[e].max_value;
+            int ok = results[e].feasible;
+            if (best >= 0 && engines[e].epsilon == 0)
+                ok = ok && value == best;
+            else if (best >= 0)
+                ok = ok && value <= best && value >= (long double)best * (1 - engines[e].epsilon);
+            check = ok ? "ok" : "MISMATCH";
+            failed += !ok;
+            if (!ok)
+                fprintf(stderr, "bench: %s on %s n=%d capacity=%lld does not match the exact engines\n",
+                        engines[e].name, instance_class->name, n, capacity);
+            ms = results[e].seconds * 1e3;
+            cells_per_s = results[e].seconds > 0 ? (double)n * (capacity + 1) / results[e].seconds : 0;
+            max_value = results[e].max_value;
+        }
+
+        fprintf(out, "%s,%d,%lld,%lld,%lld,%s,%s,%lld,%.3f,%ld,%.3e,%s\n",
+                instance_class->name, n, percent, capacity, range, engines[e].name, reduce ? "yes" : "no",
+                max_value, ms, results[e].peak_kb, cells_per_s, check);
+        fflush(out);
+    }
+
+    failed += benchIncremental(out, instance_class, n, percent, capacity, range, engine_names, weights, values);
+    free(weights);
+    free(values);
+    return failed;
+}
+
+//------------------------------------------------
+// Command line
+//------------------------------------------------
+
+// parses "a,b,c" into values, returns how many there are
+static int parseList(const char *text, long long values[MAX_LIST])
+{
+    int count = 0;
+    const char *p = text;
+    while (*p != '\0' && count < MAX_LIST)
+    {
+        char *after;
+        values[count++] = strtoll(p, &after, 10);
+        if (after == p)
+            return -1;
+        p = *after == ',' ? after + 1 : after;
+    }
+    return count;
+}
+
+static int usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n 40,1000,...] [-w 10,50,... (percents of the total weight)]\n"
+            "          [-c uncorrelated,weak,strong,inverse,subset,spanner]\n"
+            "          [-e auto,dp,value,bnb,mitm,pareto,fptas,stack,ops] [-r range] [-l seconds] [-x]\n"
+            "          [-s seed] [-o file.csv]\n",
+            name);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    long long sizes[MAX_LIST] = {40, 1000};
+    int num_sizes = 2;
+    long long percents[MAX_LIST] = {10, 50};
+    int num_percents = 2;
+    const char *class_names = "uncorrelated,weak,strong,inverse,subset,spanner";
+    const char *engine_names = "auto,dp,value,bnb,mitm,pareto,fptas,stack,ops";
+    long long range = 1000;
+    int seconds = 10;
+    int reduce = TRUE;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        // -x - solve without the reduction
+        if (strcmp(argv[i], "-x") == 0)
+        {
+            reduce = FALSE;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return usage(argv[0]);
+
+        if (strcmp(argv[i], "-n") == 0)
+            num_sizes = parseList(argv[++i], sizes);
+        else if (strcmp(argv[i], "-w") == 0)
+            num_percents = parseList(argv[++i], percents);
+        else if (strcmp(argv[i], "-c") == 0)
+            class_names = argv[++i];
+        else if (strcmp(argv[i], "-e") == 0)
+            engine_names = argv[++i];
+        else if (strcmp(argv[i], "-r") == 0)
+            range = atoll(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0)
+            seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0)
+            rng_state = strtoull(argv[++i], NULL, 10) | 1;
+        else if (strcmp(argv[i], "-o") == 0)
+            out_path = argv[++i];
+        else
+            return usage(argv[0]);
+    }
+    if (num_sizes <= 0 || num_percents <= 0 || range < 1 || seconds < 1)
+        return usage(argv[0]);
+    for (int s = 0; s < num_sizes; s++)
+    {
+        // the total weight (range + range / 10 at most per item) has to fit in a long long
+        if (sizes[s] < 1 || sizes[s] > 100000000 || range > LLONG_MAX / 2 / sizes[s])
+            return usage(argv[0]);
+    }
+    for (int w = 0; w < num_percents; w++)
+    {
+        if (percents[w] < 0 || percents[w] > 100)
+            return usage(argv[0]);
+    }
+
+    FILE *out = out_path == NULL ? stdout : fopen(out_path, "w");
+    if (out == NULL)
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    fprintf(out, "class,n,percent,capacity,range,engine,reduce,max_value,ms,peak_kb,cells_per_s,check\n");
+
+    int failed = 0;
+    for (int c = 0; c < NUM_CLASSES; c++)
+    {
+        // only the classes that were asked for
+        if (!inList(class_names, classes[c].name))
+            continue;
+
+        for (int s = 0; s < num_sizes; s++)
+        {
+            for (int w = 0; w < num_percents; w++)
+            {
+                failed += benchOne(out, &classes[c], (int)sizes[s], percents[w], range,
+                                   engine_names, reduce, seconds);
+            }
+        }
+    }
+
+    if (out != stdout)
+        fclose(out);
+    return failed != 0 ? 1 : 0;
+}
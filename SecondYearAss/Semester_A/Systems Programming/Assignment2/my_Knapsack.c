@@ -1,112 +1,318 @@
-#include "my_mat.h"
+#include "my_knap.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define ITEM_NAME_MAX_LEN 20
 #define MAX_KG 20
 #define NUM_OF_ITEMS 5
+
+// the stream mode reads and solves this many instances at a time
+#define STREAM_CHUNK 4096
+
+typedef char ItemName[ITEM_NAME_MAX_LEN + 1];
+
 /**
- * return the max of two numbers
- * @param a the first number
- * @param b the second number
+ * The engine of a name from the command line
+ * @return one of the KNAP_ engines, -1 for an unknown name
  */
-int max(int a, int b)
+int engineByName(const char *name)
 {
-    return (a > b) ? a : b;
+    if (strcmp(name, "auto") == 0)
+        return KNAP_AUTO;
+    if (strcmp(name, "dp") == 0)
+        return KNAP_DP;
+    if (strcmp(name, "bnb") == 0)
+        return KNAP_BNB;
+    if (strcmp(name, "mitm") == 0)
+        return KNAP_MITM;
+    if (strcmp(name, "value") == 0)
+        return KNAP_VALUE_DP;
+    if (strcmp(name, "fptas") == 0)
+        return KNAP_FPTAS;
+    if (strcmp(name, "pareto") == 0)
+        return KNAP_PARETO;
+    return -1;
 }
 
 /**
- * Solve the integer knapsack problem
- * @param weights the weights of the items
- * @param values the values of the items
- * @param selected_bool the selected items in boolean values - 1 for selected, 0 for not selected
- * @return the maximum value
- *
+ * Print the answer of one instance
+ * @param selected the selected items in boolean values
+ * @param taken how many times every item is taken, NULL to print only the names
  */
-int knapSack(int weights[], int values[], int selected_bool[])
+void printAnswer(ItemName itemNames[], const int selected[], const long long taken[], int n, long long max_value)
 {
-    // Initialize the selected items array to false
-    for (int i = 0; i < NUM_OF_ITEMS; i++)
+    printf("Maximum profit: %lld\n", max_value);
+    printf("Selected items: ");
+
+    // with counts every item is name*count
+    char *last = NULL;
+    long long last_count = 0;
+    for (int i = 0; i < n; i++)
     {
-        selected_bool[i] = FALSE;
+
+        if (selected[i])
+        {
+            if (last != NULL && taken != NULL)
+            {
+                printf("%s*%lld ", last, last_count);
+            }
+            else if (last != NULL)
+            {
+                printf("%s ", last);
+            }
+            last = itemNames[i];
+            last_count = taken != NULL ? taken[i] : 1;
+        }
     }
+    if (last != NULL && taken != NULL)
+        printf("%s*%lld", last, last_count);
+    else if (last != NULL)
+        printf("%s", last);
+}
 
-    // Create a dp array
-    int dp[NUM_OF_ITEMS + 1][MAX_KG + 1];
+/**
+ * Stream mode - read instances of num_items items until the input ends,
+ * STREAM_CHUNK at a time, solve every chunk on num_threads threads (each with
+ * its own solver, kept from one chunk to the next) and print the answers in
+ * the order the instances came in, one after the other
+ * @return the exit status
+ */
+int runStream(int num_items, long long capacity, int num_threads, int engine, double epsilon)
+{
+    size_t cells = (size_t)STREAM_CHUNK * num_items + 1;
+    ItemName *itemNames = malloc(sizeof(ItemName) * cells);
+    long long *values = malloc(sizeof(long long) * cells);
+    long long *weights = malloc(sizeof(long long) * cells);
+    int *selected = malloc(sizeof(int) * cells);
+    KnapInstance *instances = malloc(sizeof(KnapInstance) * STREAM_CHUNK);
+    Knapsack **solvers = calloc(num_threads, sizeof(Knapsack *));
+    int status = 0;
 
-    // i is the number of items, B is the maximum weight
-    int i, B;
+    if (itemNames == NULL || values == NULL || weights == NULL || selected == NULL || instances == NULL ||
+        solvers == NULL)
+    {
+        printf("Error: out of memory\n");
+        status = 1;
+    }
+    for (int t = 0; t < num_threads && status == 0; t++)
+    {
+        solvers[t] = Knapsack_alloc();
+        if (solvers[t] == NULL)
+        {
+            printf("Error: out of memory\n");
+            status = 1;
+            break;
+        }
+        Knapsack_setEngine(solvers[t], engine);
+        Knapsack_setEpsilon(solvers[t], epsilon);
+    }
 
-    // Initialize the dp array
-    for (i = 0; i <= NUM_OF_ITEMS; i++)
+    int done = status != 0 ? TRUE : FALSE;
+    while (done == FALSE)
     {
-        for (B = 0; B <= MAX_KG; B++)
+        // read a chunk - the input may only end between two instances
+        int count = 0;
+        int invalid = FALSE;
+        for (; count < STREAM_CHUNK && done == FALSE; count++)
         {
-            // Base case - if there are no items or the maximum weight is 0, the value is 0
-            if (i == 0 || B == 0)
+            size_t first = (size_t)count * num_items;
+            for (int i = 0; i < num_items; i++)
             {
-                dp[i][B] = 0;
+                int read = scanf("%20s %lld %lld", itemNames[first + i], &values[first + i], &weights[first + i]);
+                if (read == EOF && i == 0)
+                {
+                    done = TRUE;
+                    break;
+                }
+                if (read != 3 || values[first + i] < 0 || weights[first + i] < 0)
+                {
+                    invalid = TRUE;
+                    done = TRUE;
+                    break;
+                }
             }
-            else if (weights[i - 1] <= B) // If the weight of the item is less than the maximum weight - we can choose to take it or not
-            {
-                // Choose the maximum value between taking the item and not taking the item
-                dp[i][B] = max(values[i - 1] + dp[i - 1][B - weights[i - 1]], dp[i - 1][B]);
-            }
-            else // If the weight of the item is more than the maximum weight - we can't take it
+            if (done == TRUE)
+                break;
+
+            instances[count].n = num_items;
+            instances[count].weights = weights + first;
+            instances[count].values = values + first;
+            instances[count].capacity = capacity;
+            instances[count].selected = selected + first;
+        }
+
+        Knapsack_solveAll(solvers, num_threads, instances, count);
+
+        for (int k = 0; k < count; k++)
+        {
+            size_t first = (size_t)k * num_items;
+            if (instances[k].max_value < 0)
             {
-                dp[i][B] = dp[i - 1][B];
+                printf("Error: out of memory or too many items for the engine\n");
+                status = 1;
+                continue;
             }
+            printAnswer(itemNames + first, selected + first, NULL, num_items, instances[k].max_value);
+            printf("\n");
+        }
+        if (invalid == TRUE)
+        {
+            printf("Invalid input\n");
+            status = 1;
         }
+        // with no items every instance is empty, so the input never ends
+        if (num_items == 0)
+            done = TRUE;
     }
 
-    // Find the selected items - we start from the last item and go back
-    i = NUM_OF_ITEMS;
-    B = MAX_KG;
-    while (i > 0 && B > 0) // If we haven't reached the first item and the maximum weight is not 0
+    for (int t = 0; solvers != NULL && t < num_threads; t++)
     {
-        if (dp[i][B] != dp[i - 1][B]) // If the value is different from the value of the previous item - it means we took the item
-        {
-            selected_bool[i - 1] = TRUE; // Mark the item as selected
-            B -= weights[i - 1];         // Subtract the weight of the item from the maximum weight
-        }
-        i--;
+        Knapsack_free(solvers[t]);
     }
-    // the maximum value is in the last cell of the dp array
-    return dp[NUM_OF_ITEMS][MAX_KG];
+    free(solvers);
+    free(instances);
+    free(itemNames);
+    free(values);
+    free(weights);
+    free(selected);
+    return status;
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
-    char itemNames[NUM_OF_ITEMS][ITEM_NAME_MAX_LEN + 1];
-    int values[NUM_OF_ITEMS];
-    int weights[NUM_OF_ITEMS];
-    int selected_bool[NUM_OF_ITEMS];
-
-    for (int i = 0; i < NUM_OF_ITEMS; i++)
+    // -n <count>    - the number of items to read, NUM_OF_ITEMS by default
+    // -w <capacity> - the capacity of the knapsack, MAX_KG by default
+    // -t <threads>  - split the dp rows between threads
+    // -e <engine>   - auto, dp, value (dp over the values), bnb (branch and bound), mitm
+    //                 (meet in the middle), pareto (sparse dp) or fptas (approximate), auto by default
+    // -a <epsilon>  - the fptas, at least (1 - epsilon) of the optimum (0.1 by default)
+    // -q            - every item has a count after its weight, how many there are (-1 for no limit)
+    // -u            - every item can be taken any number of times
+    // -s <threads>  - stream mode, solve instance after instance until the input ends
+    int num_items = NUM_OF_ITEMS;
+    long long capacity = MAX_KG;
+    int num_threads = 1;
+    int engine = KNAP_AUTO;
+    double epsilon = 0.1;
+    int with_counts = FALSE;
+    int unbounded = FALSE;
+    int stream_threads = 0;
+    for (int i = 1; i < argc; i++)
     {
-        if (scanf("%s %d %d", itemNames[i], &values[i], &weights[i]) != 3)
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0)
         {
-            printf("Invalid input\n");
+            num_items = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc && atoll(argv[i + 1]) >= 0)
+        {
+            capacity = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1)
+        {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc && engineByName(argv[i + 1]) != -1)
+        {
+            engine = engineByName(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0 && atof(argv[i + 1]) < 1)
+        {
+            engine = KNAP_FPTAS;
+            epsilon = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-q") == 0)
+        {
+            with_counts = TRUE;
+        }
+        else if (strcmp(argv[i], "-u") == 0)
+        {
+            unbounded = TRUE;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1)
+        {
+            stream_threads = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Usage: %s [-n items] [-w capacity] [-t threads] [-e auto|dp|value|bnb|mitm|pareto|fptas] [-a epsilon] [-q | -u] [-s threads]\n", argv[0]);
             return 1;
         }
     }
+    if (stream_threads > 0 && (with_counts == TRUE || unbounded == TRUE))
+    {
+        printf("Error: -s solves 0/1 items only\n");
+        return 1;
+    }
+    if (stream_threads > 0)
+        return runStream(num_items, capacity, stream_threads, engine, epsilon);
 
-    int max_value = knapSack(weights, values, selected_bool);
-    printf("Maximum profit: %d\n", max_value);
-    printf("Selected items: ");
+    ItemName *itemNames = malloc(sizeof(ItemName) * num_items + 1);
+    long long *values = malloc(sizeof(long long) * num_items + 1);
+    long long *weights = malloc(sizeof(long long) * num_items + 1);
+    int *selected_bool = malloc(sizeof(int) * num_items + 1);
+    long long *counts = malloc(sizeof(long long) * num_items + 1);
+    long long *taken = malloc(sizeof(long long) * num_items + 1);
+    Knapsack *knap = Knapsack_alloc();
+    int status = 0;
+    long long max_value = -1;
 
-    char *last = NULL;
-    for (int i = 0; i < NUM_OF_ITEMS; i++)
+    if (itemNames == NULL || values == NULL || weights == NULL || selected_bool == NULL || counts == NULL ||
+        taken == NULL || knap == NULL ||
+        Knapsack_setThreads(knap, num_threads) == FALSE)
+    {
+        printf("Error: out of memory\n");
+        status = 1;
+    }
+
+    for (int i = 0; i < num_items && status == 0; i++)
     {
+        if (scanf("%20s %lld %lld", itemNames[i], &values[i], &weights[i]) != 3 || values[i] < 0 || weights[i] < 0 ||
+            (with_counts == TRUE && (scanf("%lld", &counts[i]) != 1 || counts[i] < KNAP_UNBOUNDED)))
+        {
+            printf("Invalid input\n");
+            status = 1;
+        }
+        if (unbounded == TRUE)
+            counts[i] = KNAP_UNBOUNDED;
+    }
 
-        if (selected_bool[i])
+    if (status == 0 && (with_counts == TRUE || unbounded == TRUE))
+    {
+        max_value = Knapsack_solveBounded(knap, num_items, weights, values, counts, capacity, taken);
+        for (int i = 0; i < num_items; i++)
         {
-            if (last != NULL)
-            {
-                printf("%s ", last);
-            }
-            last = itemNames[i];
+            selected_bool[i] = taken[i] > 0 ? TRUE : FALSE;
         }
     }
-    printf("%s", last);
-    return 0;
-}
\ No newline at end of file
+    else if (status == 0)
+    {
+        Knapsack_setEngine(knap, engine);
+        Knapsack_setEpsilon(knap, epsilon);
+        max_value = Knapsack_solve(knap, num_items, weights, values, capacity, selected_bool);
+    }
+    if (status == 0 && max_value < 0)
+    {
+        printf("Error: out of memory or too many items for the engine\n");
+        status = 1;
+    }
+
+    if (status == 0)
+    {
+        printAnswer(itemNames, selected_bool, with_counts == TRUE || unbounded == TRUE ? taken : NULL,
+                    num_items, max_value);
+        // (1 - epsilon) * optimum <= max_value
+        if (engine == KNAP_FPTAS && with_counts == FALSE && unbounded == FALSE)
+            printf("\nApproximation: at least %g of the optimum, which is at most %lld",
+                   1 - epsilon, (long long)(max_value / (1 - epsilon)));
+    }
+
+    free(itemNames);
+    free(values);
+    free(weights);
+    free(selected_bool);
+    free(counts);
+    free(taken);
+    Knapsack_free(knap);
+    return status;
+}
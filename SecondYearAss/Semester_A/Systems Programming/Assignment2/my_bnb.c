@@ -0,0 +1,531 @@
+#include <stdlib.h>
+#include <string.h>
+#include "my_knap_engine.h"
+
+// the nodes the branch and bound looks at before it goes on to the core
+#define BNB_MAX_NODES (1 << 20)
+
+// the most pairs the core keeps, and merges in all - past them the engine gives up
+#define CORE_MAX_STATES (1 << 20)
+#define CORE_MAX_WORK (1LL << 27)
+
+// an item the search can change, the items are sorted by value / weight
+typedef struct
+{
+    long long weight;
+    long long value;
+    int index;
+} BnbItem;
+
+/*
+ * A node of the search - the items [0, s] may still be taken out and the items
+ * [t, count) may still be put in. change is the item this node changed from its
+ * parent (-1 for none), and depth the number of changes from the break solution.
+ */
+typedef struct
+{
+    int s;
+    int t;
+    int depth;
+    int change;
+    long long value;
+    long long weight;
+} BnbNode;
+
+static int byEfficiency(const void *a, const void *b)
+{
+    const BnbItem *x = a;
+    const BnbItem *y = b;
+    __int128 left = (__int128)x->value * y->weight;
+    __int128 right = (__int128)y->value * x->weight;
+    if (left != right)
+        return left > right ? -1 : 1;
+    // the lighter first, then the input order, so the order doesn't depend on qsort
+    if (x->weight != y->weight)
+        return x->weight < y->weight ? -1 : 1;
+    return x->index - y->index;
+}
+
+static int byWeight(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return x == y ? 0 : (x < y ? -1 : 1);
+}
+
+// the LP bound of the items worth more than shift, with shift taken off every value
+static __int128 shiftedBound(BnbItem shifted[], const BnbItem items[], int count, long long capacity,
+                             long long shift)
+{
+    int size = 0;
+    for (int k = 0; k < count; k++)
+    {
+        if (items[k].value > shift)
+        {
+            shifted[size] = items[k];
+            shifted[size].value -= shift;
+            size++;
+        }
+    }
+    qsort(shifted, size, sizeof(BnbItem), byEfficiency);
+
+    __int128 bound = 0;
+    long long room = capacity;
+    for (int k = 0; k < size; k++)
+    {
+        if (shifted[k].weight > room)
+        {
+            bound += (__int128)room * shifted[k].value / shifted[k].weight;
+            break;
+        }
+        room -= shifted[k].weight;
+        bound += shifted[k].value;
+    }
+    return bound;
+}
+
+/**
+ * A bound from the number of items - no solution has more than the lightest
+ * items that fit, most, so for any shift taking it off every value and adding
+ * most * shift back is a bound too (Lagrange). The best shift is looked for with
+ * a ternary search, the bound being convex in it. On the strongly correlated
+ * instances (value = weight + a constant) it is much tighter than the LP bound
+ * - with the constant as the shift it is the capacity and most constants.
+ * @param shifted room for count items
+ * @return the bound, -1 if every item fits in at once (there is nothing to bound then)
+ */
+static __int128 cardinalityBound(Knapsack *knap, BnbItem shifted[], const BnbItem items[], int count,
+                                 long long capacity)
+{
+    long long *weights = knapTake(knap, sizeof(long long) * (count + 1));
+    if (weights == NULL)
+        return -1;
+    long long max_value = 0;
+    for (int k = 0; k < count; k++)
+    {
+        weights[k] = items[k].weight;
+        if (items[k].value > max_value)
+            max_value = items[k].value;
+    }
+    qsort(weights, count, sizeof(long long), byWeight);
+    int most = 0;
+    long long fill = 0;
+    while (most < count && fill + weights[most] <= capacity)
+    {
+        fill += weights[most++];
+    }
+    if (most == count)
+        return -1;
+
+    long long low = 0;
+    long long high = max_value;
+    __int128 best = -1;
+    while (TRUE)
+    {
+        long long first = low + (high - low) / 3;
+        long long second = high - (high - low) / 3;
+        __int128 at_first = shiftedBound(shifted, items, count, capacity, first) + (__int128)first * most;
+        __int128 at_second = shiftedBound(shifted, items, count, capacity, second) + (__int128)second * most;
+        __int128 lower = at_first < at_second ? at_first : at_second;
+        if (best < 0 || lower < best)
+            best = lower;
+        if (high - low < 3)
+            break;
+        if (at_first < at_second)
+            high = second - 1;
+        else
+            low = first + 1;
+    }
+    return best;
+}
+
+// the pairs of the core, grown with realloc like the Pareto engine's
+typedef struct
+{
+    KnapState *list;
+    KnapState *tmp;
+    size_t room;
+} CoreLists;
+
+static int growCore(CoreLists *core, size_t size)
+{
+    if (size <= core->room)
+        return TRUE;
+    size_t room = core->room * 2 > size ? core->room * 2 : size;
+    KnapState *list = realloc(core->list, sizeof(KnapState) * room);
+    if (list == NULL)
+        return FALSE;
+    core->list = list;
+    KnapState *tmp = realloc(core->tmp, sizeof(KnapState) * room);
+    if (tmp == NULL)
+        return FALSE;
+    core->tmp = tmp;
+    core->room = room;
+    return TRUE;
+}
+
+/**
+ * The bound of a pair of the core [s + 1, t - 1] with the items outside it (the
+ * LP relaxation) - below the capacity the room is filled with the items t,
+ * t + 1, ... in order, the last one in part, above it the extra weight is taken
+ * out of the items s, s - 1, ... the same way.
+ * @param sum_weights the weight of the items [0, k) for every k, sum_values their value
+ * @return the bound, -1 if the pair can't get down to the capacity
+ */
+static __int128 coreBound(const BnbItem items[], const long long sum_weights[], const long long sum_values[],
+                          int count, int s, int t, long long capacity, const KnapState *pair)
+{
+    if (pair->weight <= capacity)
+    {
+        // the items [t, j) fit in the room, item j doesn't
+        long long room = capacity - pair->weight;
+        int low = t;
+        int high = count;
+        while (low < high)
+        {
+            int mid = (low + high + 1) / 2;
+            if (sum_weights[mid] - sum_weights[t] <= room)
+                low = mid;
+            else
+                high = mid - 1;
+        }
+        __int128 bound = (__int128)pair->value + (sum_values[low] - sum_values[t]);
+        if (low < count)
+            bound += (__int128)(room - (sum_weights[low] - sum_weights[t])) * items[low].value / items[low].weight;
+        return bound;
+    }
+
+    long long over = pair->weight - capacity;
+    if (s < 0 || sum_weights[s + 1] < over)
+        return -1;
+    // the items [i + 1, s] come out whole, item i in part
+    int low = 0;
+    int high = s;
+    while (low < high)
+    {
+        int mid = (low + high + 1) / 2;
+        if (sum_weights[s + 1] - sum_weights[mid] >= over)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    long long left = over - (sum_weights[s + 1] - sum_weights[low + 1]);
+    __int128 lost = (__int128)left * items[low].value;
+    return (__int128)pair->value - (sum_values[s + 1] - sum_values[low + 1]) -
+           (lost + items[low].weight - 1) / items[low].weight;
+}
+
+/**
+ * Pisinger's minknap, for when the branch and bound runs out of nodes. The core
+ * is the items [s + 1, t - 1] around the break item - the ones before it are
+ * taken and the ones after it are not. Its pairs are the (weight, value) of the
+ * break solution with some of the core items changed, and the core grows one
+ * item at a time, on both sides in turn: putting in item t or taking out item
+ * s merges the pairs with themselves shifted by it, like the Pareto engine.
+ * Every pair is then bounded with the items left outside the core (coreBound)
+ * and the ones that can't beat the best value are dropped, so the core stays
+ * small and most items are never added.
+ * @param bound no solution is worth more, the core stops once the best one is
+ * @param best_value the best value so far, raised to the best pair's
+ * @param best_link the link of the best pair, -1 if no pair beats best_value
+ * @return FALSE if there is not enough memory or the pairs grow past
+ * CORE_MAX_STATES or CORE_MAX_WORK
+ */
+static int solveCore(const BnbItem items[], const long long sum_weights[], const long long sum_values[],
+                     int count, int b, long long value, long long weight, long long capacity, __int128 bound,
+                     KnapLinks *links, long long *best_value, int *best_link)
+{
+    CoreLists core = {NULL, NULL, 0};
+    int ok = growCore(&core, 1024);
+    int size = 1;
+    if (ok)
+    {
+        core.list[0].weight = weight;
+        core.list[0].value = value;
+        core.list[0].link = -1;
+    }
+    KnapState best = {0, *best_value, -1};
+
+    int s = b - 1;
+    int t = b;
+    int put_in = TRUE;
+    long long work = 0;
+    while (ok && size > 0 && (s >= 0 || t < count) && best.value < bound)
+    {
+        // the side to grow - in turn, while there are items left on it
+        put_in = t < count && (s < 0 || put_in);
+        int k = put_in ? t++ : s--;
+        long long item_weight = put_in ? items[k].weight : -items[k].weight;
+        long long item_value = put_in ? items[k].value : -items[k].value;
+        put_in = !put_in;
+
+        // one more room than the pairs, for the best pair when the links are compacted
+        ok = growCore(&core, 2 * (size_t)size + 1);
+        if (!ok)
+            break;
+        const KnapState *list = core.list;
+        KnapState *merged = core.tmp;
+        int a = 0;
+        int c = 0;
+        int merged_size = 0;
+        while (a < size || c < size)
+        {
+            // the pairs with item k changed, merged by weight (both are sorted)
+            KnapState next;
+            int is_new = FALSE;
+            if (c < size && (a >= size || list[c].weight + item_weight < list[a].weight))
+            {
+                next.weight = list[c].weight + item_weight;
+                next.value = list[c].value + item_value;
+                next.link = list[c].link;
+                is_new = TRUE;
+                c++;
+            }
+            else
+            {
+                next = list[a++];
+            }
+
+            // keep only the pairs worth more than every lighter one
+            if (merged_size > 0 && next.value <= merged[merged_size - 1].value)
+                continue;
+            if (merged_size > 0 && next.weight == merged[merged_size - 1].weight)
+                merged_size--;
+            if (is_new)
+            {
+                next.link = knapLinkNew(links, next.link, k);
+                if (next.link < 0)
+                {
+                    ok = FALSE;
+                    break;
+                }
+            }
+            merged[merged_size++] = next;
+        }
+        core.tmp = core.list;
+        core.list = merged;
+        work += merged_size;
+        if (!ok || work > CORE_MAX_WORK)
+        {
+            ok = FALSE;
+            break;
+        }
+
+        // the heaviest pair that fits is the best one that does
+        for (int p = 0; p < merged_size && merged[p].weight <= capacity; p++)
+        {
+            if (merged[p].value > best.value)
+                best = merged[p];
+        }
+
+        // drop the pairs whose bound with the items outside the core isn't above the best
+        size = 0;
+        for (int p = 0; p < merged_size; p++)
+        {
+            if (coreBound(items, sum_weights, sum_values, count, s, t, capacity, &merged[p]) > best.value)
+                merged[size++] = merged[p];
+        }
+        if (size > CORE_MAX_STATES)
+        {
+            ok = FALSE;
+            break;
+        }
+
+        // the best pair's links are kept with the others'
+        merged[size] = best;
+        ok = knapLinksCompact(links, merged, size + 1);
+        best = merged[size];
+    }
+
+    if (ok && best.link >= 0)
+    {
+        *best_value = best.value;
+        *best_link = best.link;
+    }
+    free(core.list);
+    free(core.tmp);
+    return ok;
+}
+
+/*
+ * Pisinger's expknap. The items are sorted by efficiency and the greedy solution
+ * takes them in order until the break item b, the first that doesn't fit. The
+ * search starts from it and only ever changes items around b: below the
+ * capacity it tries to put in the next item after b, above it to take out the
+ * next item before b. The items on each side are at most as efficient as the
+ * one looked at, so value + room * its efficiency is an upper bound (Dantzig),
+ * and most of the items far from b are never looked at. On the instances
+ * where the search grows too big (strongly correlated ones) it stops after
+ * BNB_MAX_NODES nodes, the bound is tightened with the number of items
+ * (cardinalityBound) and the core (solveCore) finishes from its best solution.
+ */
+int knapSolveBnb(Knapsack *knap, int n, const long long weights[], const long long values[],
+                 long long capacity, int selected[])
+{
+    BnbItem *items = knapTake(knap, sizeof(BnbItem) * (n + 1));
+    if (items == NULL)
+        return FALSE;
+
+    // the items that weigh nothing are always taken, the ones worth nothing or
+    // heavier than the knapsack never
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (values[i] == 0 || weights[i] > capacity)
+            continue;
+        if (weights[i] == 0)
+        {
+            selected[i] = TRUE;
+            continue;
+        }
+        items[count].weight = weights[i];
+        items[count].value = values[i];
+        items[count].index = i;
+        count++;
+    }
+    qsort(items, count, sizeof(BnbItem), byEfficiency);
+
+    // the break solution
+    int b = 0;
+    long long value = 0;
+    long long weight = 0;
+    while (b < count && weight + items[b].weight <= capacity)
+    {
+        value += items[b].value;
+        weight += items[b].weight;
+        b++;
+    }
+
+    BnbNode *stack = knapTake(knap, sizeof(BnbNode) * (count + 2));
+    int *path = knapTake(knap, sizeof(int) * (count + 1));
+    int *best = knapTake(knap, sizeof(int) * (count + 1));
+    if (stack == NULL || path == NULL || best == NULL)
+        return FALSE;
+
+    // the first lower bound - the break solution and every later item that still fits
+    long long best_value = value;
+    long long fill = weight;
+    int best_len = 0;
+    for (int t = b + 1; t < count; t++)
+    {
+        if (fill + items[t].weight <= capacity)
+        {
+            fill += items[t].weight;
+            best_value += items[t].value;
+            best[best_len++] = t;
+        }
+    }
+
+    // no solution is better than the bound of the break solution - once one
+    // reaches it the search is over (subset sum instances end here)
+    __int128 root_bound = value;
+    if (b < count)
+        root_bound += (__int128)(capacity - weight) * items[b].value / items[b].weight;
+
+    int top = 0;
+    long long nodes = 0;
+    BnbNode root = {b - 1, b, 0, -1, value, weight};
+    stack[top++] = root;
+    while (top > 0 && best_value < root_bound && nodes < BNB_MAX_NODES)
+    {
+        BnbNode node = stack[--top];
+        nodes++;
+        if (node.change != -1)
+            path[node.depth - 1] = node.change;
+
+        if (node.weight <= capacity)
+        {
+            if (node.value > best_value)
+            {
+                best_value = node.value;
+                best_len = node.depth;
+                memcpy(best, path, sizeof(int) * node.depth);
+            }
+            if (node.t >= count)
+                continue;
+
+            const BnbItem *item = &items[node.t];
+            __int128 bound = node.value + (__int128)(capacity - node.weight) * item->value / item->weight;
+            if (bound <= best_value)
+                continue;
+
+            // leave item t out, then try it in first
+            BnbNode skip = {node.s, node.t + 1, node.depth, -1, node.value, node.weight};
+            BnbNode take = {node.s, node.t + 1, node.depth + 1, node.t,
+                            node.value + item->value, node.weight + item->weight};
+            stack[top++] = skip;
+            stack[top++] = take;
+        }
+        else
+        {
+            if (node.s < 0)
+                continue;
+
+            const BnbItem *item = &items[node.s];
+            __int128 over = (__int128)(node.weight - capacity) * item->value;
+            __int128 bound = node.value - (over + item->weight - 1) / item->weight;
+            if (bound <= best_value)
+                continue;
+
+            // keep item s, then try to take it out first
+            BnbNode keep = {node.s - 1, node.t, node.depth, -1, node.value, node.weight};
+            BnbNode drop = {node.s - 1, node.t, node.depth + 1, node.s,
+                            node.value - item->value, node.weight - item->weight};
+            stack[top++] = keep;
+            stack[top++] = drop;
+        }
+    }
+
+    // out of nodes - the core finishes, a better pair replaces the changes of best
+    KnapLinks links;
+    int best_link = -1;
+    if (top > 0 && best_value < root_bound)
+    {
+        BnbItem *shifted = knapTake(knap, sizeof(BnbItem) * (count + 1));
+        if (shifted == NULL)
+            return FALSE;
+        __int128 bound = cardinalityBound(knap, shifted, items, count, capacity);
+        if (bound >= 0 && bound < root_bound)
+            root_bound = bound;
+    }
+    if (top > 0 && best_value < root_bound)
+    {
+        long long *sum_weights = knapTake(knap, sizeof(long long) * (count + 1));
+        long long *sum_values = knapTake(knap, sizeof(long long) * (count + 1));
+        if (sum_weights == NULL || sum_values == NULL)
+            return FALSE;
+        sum_weights[0] = 0;
+        sum_values[0] = 0;
+        for (int k = 0; k < count; k++)
+        {
+            sum_weights[k + 1] = sum_weights[k] + items[k].weight;
+            sum_values[k + 1] = sum_values[k] + items[k].value;
+        }
+
+        int ok = knapLinksInit(&links) && solveCore(items, sum_weights, sum_values, count, b, value, weight,
+                                                    capacity, root_bound, &links, &best_value, &best_link);
+        if (ok && best_link >= 0)
+        {
+            best_len = 0;
+            for (int link = best_link; link >= 0; link = links.links[link].prev)
+            {
+                best[best_len++] = links.links[link].item;
+            }
+        }
+        knapLinksFree(&links);
+        if (!ok)
+            return FALSE;
+    }
+
+    // the break solution, with the changes of the best one
+    for (int k = 0; k < count; k++)
+    {
+        selected[items[k].index] = k < b ? TRUE : FALSE;
+    }
+    for (int k = 0; k < best_len; k++)
+    {
+        int index = items[best[k]].index;
+        selected[index] = selected[index] == TRUE ? FALSE : TRUE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <string.h>
+#include "my_knap_engine.h"
+
+// how many times an item can be taken, at most as many as fit in the capacity
+static long long usableCount(long long weight, long long count, long long capacity)
+{
+    if (weight == 0)
+        return count;
+    long long fit = capacity / weight;
+    return count == KNAP_UNBOUNDED || count > fit ? fit : count;
+}
+
+/**
+ * Add an item that can be taken up to count times to a dp row:
+ * dst[c] = max over t <= count of src[c - t * weight] + t * value.
+ * The cells c = r, r + weight, r + 2 * weight ... of every remainder r only look
+ * at each other, and the best of the last count + 1 of them is a sliding window
+ * maximum - a monotone queue of src[c] - j * value makes it O(capacity) for any count
+ * @param queue room for capacity + 1 steps j of the window
+ * @param queue_values room for capacity + 1 values
+ */
+static void boundedRow(const long long *src, long long *dst, long long capacity, long long weight,
+                       long long value, long long count, long long *queue, long long *queue_values)
+{
+    if (count == 0 || value == 0)
+    {
+        memcpy(dst, src, sizeof(long long) * (capacity + 1));
+        return;
+    }
+    if (weight == 0)
+    {
+        for (long long c = 0; c <= capacity; c++)
+        {
+            dst[c] = src[c] + count * value;
+        }
+        return;
+    }
+
+    // as many as fit - one pass forward, taking the item again on top of dst
+    if (count >= capacity / weight)
+    {
+        for (long long c = 0; c <= capacity; c++)
+        {
+            long long take = c >= weight ? dst[c - weight] + value : -1;
+            dst[c] = take > src[c] ? take : src[c];
+        }
+        return;
+    }
+
+    for (long long r = 0; r < weight && r <= capacity; r++)
+    {
+        long long head = 0;
+        long long tail = 0;
+        for (long long j = 0, c = r; c <= capacity; j++, c += weight)
+        {
+            long long here = src[c] - j * value;
+            while (tail > head && queue_values[tail - 1] <= here)
+            {
+                tail--;
+            }
+            queue[tail] = j;
+            queue_values[tail] = here;
+            tail++;
+            if (queue[head] < j - count)
+                head++;
+            dst[c] = queue_values[head] + j * value;
+        }
+    }
+}
+
+// the rows and queues one solve of the bounded knapsack shares between its ranges
+typedef struct
+{
+    const long long *weights;
+    const long long *values;
+    const long long *counts;
+    long long *rows[3];
+    long long *queue;
+    long long *queue_values;
+} BoundedWork;
+
+// the best value of items [lo, hi) for every capacity 0..capacity, in one of rows[0] / rows[1]
+static long long *boundedForward(BoundedWork *work, int lo, int hi, long long capacity, long long *rows[2])
+{
+    long long *src = rows[0];
+    long long *dst = rows[1];
+    memset(src, 0, sizeof(long long) * (capacity + 1));
+    for (int i = lo; i < hi; i++)
+    {
+        long long count = usableCount(work->weights[i], work->counts[i], capacity);
+        if (count == 0)
+            continue;
+        boundedRow(src, dst, capacity, work->weights[i], work->values[i], count, work->queue, work->queue_values);
+        long long *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    return src;
+}
+
+// Hirschberg again, with the counts of a single item at the bottom
+static void boundedRange(BoundedWork *work, int lo, int hi, long long capacity, long long taken[])
+{
+    if (hi <= lo)
+        return;
+    if (hi - lo == 1)
+    {
+        taken[lo] = work->values[lo] > 0 ? usableCount(work->weights[lo], work->counts[lo], capacity) : 0;
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    long long *left = boundedForward(work, lo, mid, capacity, work->rows);
+    long long *second[2] = {left == work->rows[0] ? work->rows[1] : work->rows[0], work->rows[2]};
+    long long *right = boundedForward(work, mid, hi, capacity, second);
+
+    long long split = 0;
+    long long best = -1;
+    for (long long c = 0; c <= capacity; c++)
+    {
+        if (left[c] + right[capacity - c] > best)
+        {
+            best = left[c] + right[capacity - c];
+            split = c;
+        }
+    }
+
+    boundedRange(work, lo, mid, split, taken);
+    boundedRange(work, mid, hi, capacity - split, taken);
+}
+
+int knapSolveBoundedItems(Knapsack *knap, int n, const long long weights[], const long long values[],
+                          const long long counts[], long long capacity, long long taken[])
+{
+    if (capacity >= (long long)(SIZE_MAX / sizeof(long long) / 5))
+        return FALSE;
+
+    BoundedWork work = {weights, values, counts, {NULL, NULL, NULL}, NULL, NULL};
+    size_t row_size = sizeof(long long) * (capacity + 1);
+    for (int k = 0; k < 3; k++)
+    {
+        work.rows[k] = knapTake(knap, row_size);
+    }
+    work.queue = knapTake(knap, row_size);
+    work.queue_values = knapTake(knap, row_size);
+    if (work.rows[0] == NULL || work.rows[1] == NULL || work.rows[2] == NULL ||
+        work.queue == NULL || work.queue_values == NULL)
+        return FALSE;
+
+    boundedRange(&work, 0, n, capacity, taken);
+    return TRUE;
+}
+
+long long Knapsack_solveBounded(Knapsack *knap, int n, const long long weights[], const long long values[],
+                                const long long counts[], long long capacity, long long taken[])
+{
+    for (int i = 0; i < n; i++)
+    {
+        taken[i] = 0;
+    }
+    if (n < 0 || capacity < 0)
+        return -1;
+    for (int i = 0; i < n; i++)
+    {
+        // an item of no weight that can be taken forever is worth forever
+        if (weights[i] < 0 || values[i] < 0 || (counts[i] < 0 && counts[i] != KNAP_UNBOUNDED) ||
+            (weights[i] == 0 && values[i] > 0 && counts[i] == KNAP_UNBOUNDED))
+            return -1;
+    }
+
+    long long max_value = -1;
+    if (knapSolveBoundedItems(knap, n, weights, values, counts, capacity, taken) == TRUE)
+    {
+        max_value = 0;
+        for (int i = 0; i < n; i++)
+        {
+            max_value += taken[i] * values[i];
+        }
+    }
+    knapReset(knap);
+    return max_value;
+}
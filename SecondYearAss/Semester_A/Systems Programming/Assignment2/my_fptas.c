@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include "my_knap_engine.h"
+
+// an item that fits and is worth something
+typedef struct
+{
+    long long weight;
+    long long value;
+    int index;
+} FptasItem;
+
+static int byEfficiency(const void *a, const void *b)
+{
+    const FptasItem *x = a;
+    const FptasItem *y = b;
+    __int128 left = (__int128)x->value * y->weight;
+    __int128 right = (__int128)y->value * x->weight;
+    if (left != right)
+        return left > right ? -1 : 1;
+    return x->index - y->index;
+}
+
+/*
+ * The value dp on values divided by K = epsilon * lower / n, where lower is at
+ * most the optimum (the better of the greedy solution and the best single
+ * item). Rounding every value down loses less than K per item, n * K =
+ * epsilon * lower in all, so the items found are worth at least
+ * (1 - epsilon) * the optimum. The optimum is at most the Dantzig bound
+ * upper <= 2 * lower, so the rows need only upper / K <= 2n / epsilon cells
+ * and the dp is O(n^2 / epsilon) whatever the values are.
+ */
+int knapSolveFptas(Knapsack *knap, int n, const long long weights[], const long long values[],
+                   long long capacity, int selected[])
+{
+    FptasItem *items = knapTake(knap, sizeof(FptasItem) * (n + 1));
+    long long *item_weights = knapTake(knap, sizeof(long long) * (n + 1));
+    long long *scaled = knapTake(knap, sizeof(long long) * (n + 1));
+    int *item_selected = knapTake(knap, sizeof(int) * (n + 1));
+    if (items == NULL || item_weights == NULL || scaled == NULL || item_selected == NULL)
+        return FALSE;
+
+    // the items that weigh nothing are always taken, the ones worth nothing or
+    // heavier than the knapsack never
+    int count = 0;
+    long long best_item = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (values[i] == 0 || weights[i] > capacity)
+            continue;
+        if (weights[i] == 0)
+        {
+            selected[i] = TRUE;
+            continue;
+        }
+        items[count].weight = weights[i];
+        items[count].value = values[i];
+        items[count].index = i;
+        best_item = values[i] > best_item ? values[i] : best_item;
+        count++;
+    }
+    if (count == 0)
+        return TRUE;
+    qsort(items, count, sizeof(FptasItem), byEfficiency);
+
+    // the greedy solution up to the break item, and the Dantzig bound
+    long long value = 0;
+    long long weight = 0;
+    int b = 0;
+    while (b < count && weight + items[b].weight <= capacity)
+    {
+        value += items[b].value;
+        weight += items[b].weight;
+        b++;
+    }
+    long long lower = value > best_item ? value : best_item;
+    long long upper = value;
+    if (b < count)
+        upper += (long long)((__int128)(capacity - weight) * items[b].value / items[b].weight);
+
+    long long scale = (long long)(knapEpsilon(knap) * lower / count);
+    if (scale < 1)
+        scale = 1;
+    for (int k = 0; k < count; k++)
+    {
+        item_weights[k] = items[k].weight;
+        scaled[k] = items[k].value / scale;
+        item_selected[k] = FALSE;
+    }
+
+    if (knapValueDp(knap, count, item_weights, scaled, capacity, upper / scale, item_selected) == FALSE)
+        return FALSE;
+    for (int k = 0; k < count; k++)
+    {
+        if (item_selected[k] == TRUE)
+            selected[items[k].index] = TRUE;
+    }
+    return TRUE;
+}
@@ -1,22 +1,412 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "my_mat.h"
 
-int main(void)
+// tile size of the out-of-core mode - 256 * 256 * 8 bytes = 512KB per tile
+#define TILE_SIZE 256
+
+// the batch mode writes its answers through one buffer of this size
+#define OUT_BUFFER_SIZE (1 << 20)
+
+// the engines one run answers from - exactly one of graph / tiled is set, and
+// oracle only while the matrix is symmetric
+typedef struct _Engines
+{
+    Graph *graph;
+    TiledGraph *tiled;
+    DistanceOracle *oracle;
+    int oracle_k;
+} Engines;
+
+// a 'B' or 'C' query of the batch mode
+typedef struct _Query
+{
+    char type;
+    int start;
+    int end;
+} Query;
+
+// load a new matrix into the engines, the graph solves itself again on the next query
+// returns FALSE when out of memory
+static int loadMatrix(Engines *engines, int mat[N][N])
+{
+    int loaded = TRUE;
+    for (int i = 0; engines->tiled != NULL && i < N && loaded == TRUE; i++)
+    {
+        loaded = TiledGraph_setRow(engines->tiled, i, mat[i]);
+    }
+    if (engines->graph != NULL)
+        loaded = Graph_load(engines->graph, &mat[0][0]);
+
+    // the oracle uses every edge both ways, so it is only right on a symmetric
+    // matrix - a directed one is answered exactly by the graph
+    int symmetric = TRUE;
+    for (int i = 0; i < N && symmetric == TRUE; i++)
+    {
+        for (int j = i + 1; j < N; j++)
+        {
+            if (mat[i][j] != mat[j][i])
+            {
+                symmetric = FALSE;
+                break;
+            }
+        }
+    }
+    DistanceOracle_free(engines->oracle);
+    engines->oracle = NULL;
+
+    if (engines->oracle_k > 0 && symmetric == TRUE && loaded == TRUE)
+    {
+        GraphEdge edges[N * N];
+        int num_edges = 0;
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+            {
+                if (i != j && mat[i][j] != 0)
+                {
+                    edges[num_edges].from = i;
+                    edges[num_edges].to = j;
+                    edges[num_edges].weight = mat[i][j];
+                    num_edges++;
+                }
+            }
+        }
+        engines->oracle = DistanceOracle_alloc(N, num_edges, edges, engines->oracle_k, 1);
+        loaded = engines->oracle != NULL ? TRUE : FALSE;
+    }
+    return loaded;
+}
+
+static int answerPathExists(Engines *engines, int start, int end)
+{
+    if (engines->graph != NULL)
+        return Graph_isPathExists(engines->graph, start, end);
+    return TiledGraph_isPathExists(engines->tiled, start, end);
+}
+
+static long long answerShortestPath(Engines *engines, int start, int end)
+{
+    if (engines->oracle != NULL)
+        return DistanceOracle_query(engines->oracle, start, end);
+    if (engines->graph != NULL)
+        return Graph_shortestPath(engines->graph, start, end);
+    return TiledGraph_shortestPath(engines->tiled, start, end);
+}
+
+// ~ batch mode ~
+
+static char out_buffer[OUT_BUFFER_SIZE];
+static size_t out_len = 0;
+
+static void outFlush()
+{
+    fwrite(out_buffer, 1, out_len, stdout);
+    out_len = 0;
+}
+
+static void outStr(const char *str, size_t len)
+{
+    if (out_len + len > OUT_BUFFER_SIZE)
+        outFlush();
+    memcpy(out_buffer + out_len, str, len);
+    out_len += len;
+}
+
+static void outNumber(long long number)
+{
+    char digits[24];
+    int len = 0;
+    unsigned long long value = number < 0 ? 0 - (unsigned long long)number : (unsigned long long)number;
+    do
+    {
+        digits[sizeof(digits) - 1 - len++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    if (number < 0)
+        digits[sizeof(digits) - 1 - len++] = '-';
+    outStr(digits + sizeof(digits) - len, len);
+}
+
+// read the whole stdin into one buffer ending with '\0', NULL when out of memory
+static char *readAll()
+{
+    size_t size = 1 << 16;
+    size_t len = 0;
+    char *buffer = malloc(size);
+    while (buffer != NULL)
+    {
+        len += fread(buffer + len, 1, size - len - 1, stdin);
+        if (len < size - 1)
+            break;
+        size *= 2;
+        char *bigger = realloc(buffer, size);
+        if (bigger == NULL)
+            free(buffer);
+        buffer = bigger;
+    }
+    if (buffer != NULL)
+        buffer[len] = '\0';
+    return buffer;
+}
+
+static int readNumber(const char **at, int *number)
+{
+    char *after;
+    long value = strtol(*at, &after, 10);
+    if (after == *at)
+        return FALSE;
+    *at = after;
+    *number = (int)value;
+    return TRUE;
+}
+
+// print the nodes of the shortest path from start to end, walking next one hop at a time
+static void outPath(Graph *graph, int start, int end)
+{
+    int at = start;
+    outNumber(at);
+    // a path never has more than N - 1 hops
+    for (int hops = 0; at != end && at != -1 && hops < N; hops++)
+    {
+        at = Graph_nextHop(graph, at, end);
+        outStr(" -> ", 4);
+        outNumber(at);
+    }
+    outStr("\n", 1);
+}
+
+// answer the queries of one matrix grouped by their start node, so the rows of the
+// distances are read one after the other, then print them in the order they came in
+static void answerQueries(Engines *engines, const Query *queries, int count,
+                          int *order, long long *answers, int print_path)
+{
+    int bucket[N + 1] = {0};
+    for (int q = 0; q < count; q++)
+    {
+        bucket[queries[q].start + 1]++;
+    }
+    for (int i = 0; i < N; i++)
+    {
+        bucket[i + 1] += bucket[i];
+    }
+    for (int q = 0; q < count; q++)
+    {
+        order[bucket[queries[q].start]++] = q;
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        const Query *query = &queries[order[k]];
+        if (query->type == 'B')
+            answers[order[k]] = answerPathExists(engines, query->start, query->end);
+        else
+            answers[order[k]] = answerShortestPath(engines, query->start, query->end);
+    }
+
+    for (int q = 0; q < count; q++)
+    {
+        if (queries[q].type == 'B')
+        {
+            if (answers[q] == TRUE)
+                outStr("True\n", 5);
+            else
+                outStr("False\n", 6);
+            continue;
+        }
+        outNumber(answers[q]);
+        outStr("\n", 1);
+        if (print_path == TRUE && answers[q] != -1)
+            outPath(engines->graph, queries[q].start, queries[q].end);
+    }
+}
+
+// read the whole input at once, then answer the queries between every two 'A's together
+static int runBatch(Engines *engines, int print_path)
+{
+    char *input = readAll();
+    int capacity = 1024;
+    Query *queries = malloc(sizeof(Query) * capacity);
+    int *order = malloc(sizeof(int) * capacity);
+    long long *answers = malloc(sizeof(long long) * capacity);
+    int count = 0;
+    int status = 0;
+    int done = FALSE;
+
+    if (input == NULL || queries == NULL || order == NULL || answers == NULL)
+    {
+        outStr("Error: out of memory\n", 21);
+        status = 1;
+        done = TRUE;
+    }
+
+    const char *at = input;
+    int mat[N][N];
+    while (done == FALSE)
+    {
+        char c = *at;
+        if (c == '\0')
+        {
+            answerQueries(engines, queries, count, order, answers, print_path);
+            outStr("Error: invalid input\n", 21);
+            status = 1;
+            break;
+        }
+        at++;
+
+        if (c == 'A' || c == 'D')
+        {
+            // the queries so far were on the previous matrix
+            answerQueries(engines, queries, count, order, answers, print_path);
+            count = 0;
+            if (c == 'D')
+                break;
+
+            for (int i = 0; i < N * N && status == 0; i++)
+            {
+                if (readNumber(&at, &mat[i / N][i % N]) == FALSE)
+                {
+                    outStr("Error: invalid input\n", 21);
+                    status = 1;
+                }
+            }
+            if (status == 0 && loadMatrix(engines, mat) == FALSE)
+            {
+                outStr("Error: out of memory\n", 21);
+                status = 1;
+            }
+            done = status != 0 ? TRUE : FALSE;
+        }
+        else if (c == 'B' || c == 'C')
+        {
+            if (count == capacity)
+            {
+                capacity *= 2;
+                Query *more_queries = realloc(queries, sizeof(Query) * capacity);
+                int *more_order = realloc(order, sizeof(int) * capacity);
+                long long *more_answers = realloc(answers, sizeof(long long) * capacity);
+                queries = more_queries != NULL ? more_queries : queries;
+                order = more_order != NULL ? more_order : order;
+                answers = more_answers != NULL ? more_answers : answers;
+                if (more_queries == NULL || more_order == NULL || more_answers == NULL)
+                {
+                    outStr("Error: out of memory\n", 21);
+                    status = 1;
+                    break;
+                }
+            }
+
+            Query *query = &queries[count];
+            query->type = c;
+            if (readNumber(&at, &query->start) == FALSE || readNumber(&at, &query->end) == FALSE ||
+                query->start < 0 || query->start >= N || query->end < 0 || query->end >= N)
+            {
+                answerQueries(engines, queries, count, order, answers, print_path);
+                outStr("Error: invalid input\n", 21);
+                status = 1;
+                break;
+            }
+            count++;
+        }
+    }
+
+    outFlush();
+    free(input);
+    free(queries);
+    free(order);
+    free(answers);
+    return status;
+}
+
+int main(int argc, char *argv[])
 {
+    // -s <file> - keep the shortest paths in a snapshot file and reuse them on the next run
+    // -t <file> - out-of-core mode, the distances are kept in a file of tiles
+    // -o <k>    - 'C' answers from a distance oracle, at most 2k - 1 times the shortest path -
+    //             only for symmetric (undirected) matrices, a directed one is answered exactly
+    // -b        - batch mode, read all the input first and answer the queries together
+    // -p        - batch mode that also prints the nodes of every shortest path
+    const char *snapshot_path = NULL;
+    const char *tiles_path = NULL;
+    int oracle_k = 0;
+    int batch = FALSE;
+    int print_path = FALSE;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-b") == 0)
+        {
+            batch = TRUE;
+        }
+        else if (strcmp(argv[i], "-p") == 0)
+        {
+            batch = TRUE;
+            print_path = TRUE;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            snapshot_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            tiles_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1)
+        {
+            oracle_k = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Usage: %s [-s snapshot_file | -t tiles_file] [-o k] [-b | -p]\n", argv[0]);
+            return 1;
+        }
+    }
+    // the path is walked over the next matrix of the Graph
+    if (print_path == TRUE && (tiles_path != NULL || oracle_k > 0))
+    {
+        printf("Error: -p can't be used with -t or -o\n");
+        return 1;
+    }
+
+    Engines engines = {NULL, NULL, NULL, oracle_k};
+    if (tiles_path != NULL)
+    {
+        engines.tiled = TiledGraph_alloc(tiles_path, N, TILE_SIZE);
+    }
+    else
+    {
+        engines.graph = Graph_alloc(N, NULL);
+        if (engines.graph != NULL)
+            Graph_setSnapshotPath(engines.graph, snapshot_path);
+    }
+    if (engines.graph == NULL && engines.tiled == NULL)
+    {
+        printf("Error: out of memory\n");
+        return 1;
+    }
+
+    if (batch == TRUE)
+    {
+        int status = runBatch(&engines, print_path);
+        Graph_free(engines.graph);
+        TiledGraph_free(engines.tiled);
+        DistanceOracle_free(engines.oracle);
+        return status;
+    }
 
     int mat[N][N];
     char c;
     int start, end;
-    int need_update = TRUE;
+    int status = 0;
 
     do
     {
         if (scanf("%c", &c) != 1)
         {
             printf("Error: invalid input\n");
-            return 1;
+            status = 1;
+            break;
         }
 
         if (c == 'A')
@@ -24,18 +414,27 @@ int main(void)
 
             // printf("get arrays data\n");
             // get the matrix data
-            for (int i = 0; i < N; i++)
+            for (int i = 0; i < N && status == 0; i++)
             {
                 for (int j = 0; j < N; j++)
                 {
                     if (scanf("%d", &mat[i][j]) != 1)
                     {
                         printf("Error: invalid input\n");
-                        return 1;
+                        status = 1;
+                        break;
                     }
                 }
-                // set need_update to TRUE, so that the next time isPathExists or printShortestPath is called, the floydWarshall function will be called
-                need_update = TRUE;
+            }
+            if (status != 0)
+                break;
+
+            // the graph solves itself again on the next 'B' or 'C' query
+            if (loadMatrix(&engines, mat) == FALSE)
+            {
+                printf("Error: out of memory\n");
+                status = 1;
+                break;
             }
         }
         else if (c == 'B')
@@ -43,7 +442,7 @@ int main(void)
             // printf("check if there is a path from i to j\n");
             // check if there is a path from i to j
             scanf("%d %d", &start, &end);
-            if (isPathExists(mat, start, end, need_update) == TRUE)
+            if (answerPathExists(&engines, start, end) == TRUE)
             {
                 printf("True\n");
 
@@ -54,16 +453,18 @@ int main(void)
                 printf("False\n");
                 // printf("There is no path from %d to %d\n", start, end);
             }
-            need_update = FALSE;
         }
         else if (c == 'C')
         {
             // printf("print the shortest path from i to j\n");
             // print the shortest path from i to j
             scanf("%d %d", &start, &end);
-            printShortestPath(mat, start, end, need_update);
-            need_update = FALSE;
+            printf("%lld\n", answerShortestPath(&engines, start, end));
         }
     } while (c != 'D' && c != EOF);
-    return 0;
-}
\ No newline at end of file
+
+    Graph_free(engines.graph);
+    TiledGraph_free(engines.tiled);
+    DistanceOracle_free(engines.oracle);
+    return status;
+}
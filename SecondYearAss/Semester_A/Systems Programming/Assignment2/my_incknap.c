@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "my_knap_engine.h"
+
+// the rows KnapStack keeps room for at first
+#define FIRST_STACK_ROWS 16
+
+/**
+ * Add an item to a dp row: dst[c] = max(src[c], src[c - weight] + value).
+ * src and dst may be the same row - the cells are done from the top down.
+ */
+static void addItem(const long long *src, long long *dst, long long capacity, long long weight, long long value)
+{
+    for (long long c = capacity; c >= weight; c--)
+    {
+        long long take = src[c - weight] + value;
+        dst[c] = take > src[c] ? take : src[c];
+    }
+    if (src != dst)
+        memcpy(dst, src, sizeof(long long) * (weight <= capacity ? weight : capacity + 1));
+}
+
+//------------------------------------------------
+// KnapStack
+//------------------------------------------------
+
+struct _KnapStack
+{
+    long long capacity;
+    // rows[k] is the best value of the first k items for every capacity
+    long long **rows;
+    long long *weights;
+    long long *values;
+    int size;
+    int room;
+};
+
+KnapStack *KnapStack_alloc(long long capacity)
+{
+    if (capacity < 0 || capacity >= (long long)(SIZE_MAX / sizeof(long long)))
+        return NULL;
+
+    KnapStack *stack = malloc(sizeof(KnapStack));
+    if (stack == NULL)
+        return NULL;
+    stack->capacity = capacity;
+    stack->size = 0;
+    stack->room = FIRST_STACK_ROWS;
+    stack->rows = malloc(sizeof(long long *) * (stack->room + 1));
+    stack->weights = malloc(sizeof(long long) * stack->room);
+    stack->values = malloc(sizeof(long long) * stack->room);
+    if (stack->rows == NULL || stack->weights == NULL || stack->values == NULL)
+    {
+        free(stack->rows);
+        free(stack->weights);
+        free(stack->values);
+        free(stack);
+        return NULL;
+    }
+
+    // row 0 - no items, nothing
+    stack->rows[0] = calloc(capacity + 1, sizeof(long long));
+    if (stack->rows[0] == NULL)
+    {
+        KnapStack_free(stack);
+        return NULL;
+    }
+    return stack;
+}
+
+void KnapStack_free(KnapStack *stack)
+{
+    if (stack == NULL)
+        return;
+    if (stack->rows != NULL)
+    {
+        for (int k = 0; k <= stack->size; k++)
+        {
+            free(stack->rows[k]);
+        }
+    }
+    free(stack->rows);
+    free(stack->weights);
+    free(stack->values);
+    free(stack);
+}
+
+int KnapStack_push(KnapStack *stack, long long weight, long long value)
+{
+    if (weight < 0 || value < 0)
+        return FALSE;
+
+    if (stack->size == stack->room)
+    {
+        int room = stack->room * 2;
+        long long **rows = realloc(stack->rows, sizeof(long long *) * (room + 1));
+        if (rows == NULL)
+            return FALSE;
+        stack->rows = rows;
+        long long *weights = realloc(stack->weights, sizeof(long long) * room);
+        if (weights == NULL)
+            return FALSE;
+        stack->weights = weights;
+        long long *values = realloc(stack->values, sizeof(long long) * room);
+        if (values == NULL)
+            return FALSE;
+        stack->values = values;
+        stack->room = room;
+    }
+
+    long long *row = malloc(sizeof(long long) * (stack->capacity + 1));
+    if (row == NULL)
+        return FALSE;
+    addItem(stack->rows[stack->size], row, stack->capacity, weight, value);
+
+    stack->weights[stack->size] = weight;
+    stack->values[stack->size] = value;
+    stack->size++;
+    stack->rows[stack->size] = row;
+    return TRUE;
+}
+
+void KnapStack_pop(KnapStack *stack)
+{
+    if (stack->size == 0)
+        return;
+    free(stack->rows[stack->size]);
+    stack->size--;
+}
+
+int KnapStack_remove(KnapStack *stack, int index)
+{
+    if (index < 0 || index >= stack->size)
+        return FALSE;
+
+    // the rows below index stay, the ones above are done again without it - in
+    // place, the row of the last item is left over
+    for (int k = index; k < stack->size - 1; k++)
+    {
+        stack->weights[k] = stack->weights[k + 1];
+        stack->values[k] = stack->values[k + 1];
+        addItem(stack->rows[k], stack->rows[k + 1], stack->capacity, stack->weights[k], stack->values[k]);
+    }
+    free(stack->rows[stack->size]);
+    stack->size--;
+    return TRUE;
+}
+
+int KnapStack_size(const KnapStack *stack)
+{
+    return stack->size;
+}
+
+long long KnapStack_best(const KnapStack *stack, long long capacity)
+{
+    if (capacity < 0)
+        return -1;
+    if (capacity > stack->capacity)
+        capacity = stack->capacity;
+    return stack->rows[stack->size][capacity];
+}
+
+long long KnapStack_select(const KnapStack *stack, long long capacity, int selected[])
+{
+    long long best = KnapStack_best(stack, capacity);
+    if (best < 0)
+        return -1;
+
+    // an item is taken where its row is better than the one before it
+    long long c = capacity < stack->capacity ? capacity : stack->capacity;
+    for (int k = stack->size; k > 0; k--)
+    {
+        selected[k - 1] = stack->rows[k][c] != stack->rows[k - 1][c] ? TRUE : FALSE;
+        if (selected[k - 1] == TRUE)
+            c -= stack->weights[k - 1];
+    }
+    return best;
+}
+
+//------------------------------------------------
+// Offline - a segment tree over the queries
+//------------------------------------------------
+
+// what Knapsack_solveOps shares between the nodes of the tree
+typedef struct
+{
+    const KnapOp *ops;
+    KnapOp *queries;
+    int num_queries;
+    int size;
+    long long capacity;
+    // the ops of the items of node v are items[first[v] .. first[v + 1])
+    int *first;
+    int *items;
+    long long **rows;
+} OpsTree;
+
+/**
+ * The rows of the nodes from the root down to v - rows[depth] is the one of
+ * v, with the items of every node on the way. A leaf answers its query.
+ */
+static void solveNode(OpsTree *tree, int v, int lo, int hi, int depth)
+{
+    if (lo >= tree->num_queries)
+        return;
+
+    long long *row = tree->rows[depth];
+    memcpy(row, tree->rows[depth - 1], sizeof(long long) * (tree->capacity + 1));
+    for (int k = tree->first[v]; k < tree->first[v + 1]; k++)
+    {
+        const KnapOp *op = &tree->ops[tree->items[k]];
+        if (op->weight <= tree->capacity)
+            addItem(row, row, tree->capacity, op->weight, op->value);
+    }
+
+    if (hi - lo == 1)
+    {
+        tree->queries[lo].answer = row[tree->queries[lo].capacity];
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    solveNode(tree, 2 * v, lo, mid, depth + 1);
+    solveNode(tree, 2 * v + 1, mid, hi, depth + 1);
+}
+
+/**
+ * The nodes of the tree the queries [l, r) are made of
+ * @param nodes room for 2 log(size) nodes
+ * @return the number of nodes
+ */
+static int treeNodes(int size, int l, int r, int nodes[])
+{
+    int count = 0;
+    for (l += size, r += size; l < r; l /= 2, r /= 2)
+    {
+        if (l % 2 == 1)
+            nodes[count++] = l++;
+        if (r % 2 == 1)
+            nodes[count++] = --r;
+    }
+    return count;
+}
+
+/*
+ * Every item is there from its KNAP_ADD to its KNAP_REMOVE, so it is in the
+ * queries between them - a range of them, which a segment tree over the
+ * queries splits into at most 2 log(queries) nodes. Going down the tree adds
+ * the items of every node to the row of its parent, so every item is added
+ * O(log queries) times, O(capacity) each, and nothing is ever removed.
+ */
+int Knapsack_solveOps(Knapsack *knap, long long capacity, KnapOp ops[], int count)
+{
+    if (capacity < 0 || count < 0 || capacity >= (long long)(SIZE_MAX / sizeof(long long) / 64))
+        return FALSE;
+
+    // the queries, and the query every op comes before
+    int num_queries = 0;
+    int *query_at = knapTake(knap, sizeof(int) * (count + 1));
+    int *removed_at = knapTake(knap, sizeof(int) * (count + 1));
+    if (query_at == NULL || removed_at == NULL)
+    {
+        knapReset(knap);
+        return FALSE;
+    }
+    for (int t = 0; t < count; t++)
+    {
+        query_at[t] = num_queries;
+        removed_at[t] = -1;
+        const KnapOp *op = &ops[t];
+        int ok = op->type == KNAP_ADD ? op->weight >= 0 && op->value >= 0
+                 : op->type == KNAP_REMOVE ? op->item >= 0 && op->item < t && ops[op->item].type == KNAP_ADD &&
+                                                removed_at[op->item] == -1
+                 : op->type == KNAP_QUERY ? op->capacity >= 0 && op->capacity <= capacity
+                                          : FALSE;
+        if (!ok)
+        {
+            knapReset(knap);
+            return FALSE;
+        }
+        if (op->type == KNAP_REMOVE)
+            removed_at[op->item] = t;
+        if (op->type == KNAP_QUERY)
+            num_queries++;
+    }
+    query_at[count] = num_queries;
+
+    OpsTree tree;
+    tree.ops = ops;
+    tree.num_queries = num_queries;
+    tree.capacity = capacity;
+    int depth = 1;
+    for (tree.size = 1; tree.size < num_queries; tree.size *= 2)
+    {
+        depth++;
+    }
+    tree.queries = knapTake(knap, sizeof(KnapOp) * (num_queries + 1));
+    tree.first = knapTake(knap, sizeof(int) * (2 * tree.size + 1));
+    tree.rows = knapTake(knap, sizeof(long long *) * (depth + 1));
+    if (tree.queries == NULL || tree.first == NULL || tree.rows == NULL)
+    {
+        knapReset(knap);
+        return FALSE;
+    }
+    for (int t = 0, q = 0; t < count; t++)
+    {
+        if (ops[t].type == KNAP_QUERY)
+            tree.queries[q++] = ops[t];
+    }
+
+    // the items of every node - counted, then put in place
+    int nodes[64];
+    memset(tree.first, 0, sizeof(int) * (2 * tree.size + 1));
+    for (int t = 0; t < count; t++)
+    {
+        if (ops[t].type != KNAP_ADD)
+            continue;
+        int end = removed_at[t] < 0 ? num_queries : query_at[removed_at[t]];
+        int num_nodes = treeNodes(tree.size, query_at[t], end, nodes);
+        for (int k = 0; k < num_nodes; k++)
+        {
+            tree.first[nodes[k] + 1]++;
+        }
+    }
+    for (int v = 0; v < 2 * tree.size; v++)
+    {
+        tree.first[v + 1] += tree.first[v];
+    }
+    tree.items = knapTake(knap, sizeof(int) * (tree.first[2 * tree.size] + 1));
+    int *next = knapTake(knap, sizeof(int) * (2 * tree.size + 1));
+    if (tree.items == NULL || next == NULL)
+    {
+        knapReset(knap);
+        return FALSE;
+    }
+    memcpy(next, tree.first, sizeof(int) * 2 * tree.size);
+    for (int t = 0; t < count; t++)
+    {
+        if (ops[t].type != KNAP_ADD)
+            continue;
+        int end = removed_at[t] < 0 ? num_queries : query_at[removed_at[t]];
+        int num_nodes = treeNodes(tree.size, query_at[t], end, nodes);
+        for (int k = 0; k < num_nodes; k++)
+        {
+            tree.items[next[nodes[k]]++] = t;
+        }
+    }
+
+    // a row for every depth, rows[0] is no items at all
+    for (int d = 0; d <= depth; d++)
+    {
+        tree.rows[d] = knapTake(knap, sizeof(long long) * (capacity + 1));
+        if (tree.rows[d] == NULL)
+        {
+            knapReset(knap);
+            return FALSE;
+        }
+    }
+    memset(tree.rows[0], 0, sizeof(long long) * (capacity + 1));
+    solveNode(&tree, 1, 0, tree.size, 1);
+
+    for (int t = 0, q = 0; t < count; t++)
+    {
+        if (ops[t].type == KNAP_QUERY)
+            ops[t].answer = tree.queries[q++].answer;
+    }
+    knapReset(knap);
+    return TRUE;
+}
@@ -0,0 +1,967 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "my_knap_engine.h"
+
+// a sub problem of at most this many cells is solved with a full table
+#define TABLE_CELLS (1 << 16)
+
+// the rows are updated TILE_ITEMS items at a time, over blocks of ROW_BLOCK cells
+#define TILE_ITEMS 4
+#define ROW_BLOCK 1024
+
+// rows shorter than this are not worth splitting between threads, and rows of
+// at least WAVEFRONT_CELLS don't wait for all the threads after every item
+#define PARALLEL_CELLS (1 << 16)
+#define WAVEFRONT_CELLS (1 << 22)
+
+// KNAP_AUTO uses the dp up to this many cells (items * capacity)
+#define DEFAULT_DP_BUDGET (1LL << 32)
+
+// a pair of the sparse dp costs about as much as this many cells of the dp
+#define PARETO_PAIR_CELLS 16
+
+// the epsilon of KNAP_FPTAS
+#define DEFAULT_EPSILON 0.1
+
+// the first block of a solver's memory
+#define FIRST_BLOCK_SIZE (1 << 16)
+
+// one block of a solver's memory - blocks are only added during a solve
+typedef struct _KnapBlock
+{
+    struct _KnapBlock *prev;
+    size_t size;
+    size_t used;
+    char data[];
+} KnapBlock;
+
+// one of the forward rows the threads compute together
+typedef struct
+{
+    const long long *weights;
+    const long long *values;
+    int lo;
+    int hi;
+    long long capacity;
+    long long **rows;
+    long long *result;
+} KnapJob;
+
+// a worker of the pool, the calling thread is worker 0
+typedef struct
+{
+    pthread_t thread;
+    struct _Knapsack *knap;
+    int id;
+} KnapWorker;
+
+struct _Knapsack
+{
+    // the newest block, and the size of all the blocks together
+    KnapBlock *block;
+    size_t total;
+
+    // the worker pool - num_threads - 1 threads that wait for a new generation
+    // of the job, num_threads == 1 is no pool at all
+    int num_threads;
+    KnapWorker *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    pthread_barrier_t barrier;
+    int generation;
+    int busy;
+    int stop;
+    KnapJob job;
+    // the number of items every worker finished in the wavefront
+    atomic_int *progress;
+
+    // the engine to solve with, the one the last solve used, and the dp budget of KNAP_AUTO
+    int engine;
+    int last_engine;
+    long long dp_budget;
+    // TRUE to reduce the instance before the engine
+    int reduce;
+    // how far from the optimum KNAP_FPTAS may be
+    double epsilon;
+};
+
+static void stopPool(Knapsack *knap);
+
+//------------------------------------------------
+// memory
+//------------------------------------------------
+
+static KnapBlock *newBlock(size_t size, KnapBlock *prev)
+{
+    KnapBlock *block = malloc(sizeof(KnapBlock) + size);
+    if (block == NULL)
+        return NULL;
+    block->prev = prev;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void *knapTake(Knapsack *knap, size_t size)
+{
+    // keep every row cache line aligned
+    size = (size + 63) & ~(size_t)63;
+    KnapBlock *block = knap->block;
+    uintptr_t data = (uintptr_t)block->data;
+    size_t start = ((data + block->used + 63) & ~(uintptr_t)63) - data;
+    if (start > block->size || size > block->size - start)
+    {
+        // a new block at least as big as everything so far, so there are few of them
+        size_t grow = knap->total > size + 64 ? knap->total : size + 64;
+        block = newBlock(grow, knap->block);
+        if (block == NULL)
+            return NULL;
+        knap->block = block;
+        knap->total += grow;
+        data = (uintptr_t)block->data;
+        start = ((data + 63) & ~(uintptr_t)63) - data;
+    }
+    block->used = start + size;
+    return block->data + start;
+}
+
+KnapMark knapMark(const Knapsack *knap)
+{
+    KnapMark mark = {knap->block, knap->block->used};
+    return mark;
+}
+
+// give back everything taken after the mark - blocks added after it are kept
+// until the end of the solve, so the pointers from before stay where they are
+void knapRelease(Knapsack *knap, KnapMark mark)
+{
+    for (KnapBlock *block = knap->block; block != mark.block; block = block->prev)
+    {
+        block->used = 0;
+    }
+    mark.block->used = mark.used;
+}
+
+// free everything, and keep one block as big as all of them for the next solve
+void knapReset(Knapsack *knap)
+{
+    KnapBlock *first = knap->block;
+    while (first->prev != NULL)
+    {
+        KnapBlock *prev = first->prev;
+        if (first != knap->block)
+            free(first);
+        first = prev;
+    }
+    if (first == knap->block)
+    {
+        first->used = 0;
+        return;
+    }
+
+    free(knap->block);
+    knap->block = newBlock(knap->total, NULL);
+    if (knap->block != NULL)
+    {
+        free(first);
+        return;
+    }
+    // keep the first block if there is no memory for a bigger one
+    first->used = 0;
+    knap->block = first;
+    knap->total = first->size;
+}
+
+//------------------------------------------------
+// Knapsack
+//------------------------------------------------
+
+Knapsack *Knapsack_alloc()
+{
+    Knapsack *knap = malloc(sizeof(Knapsack));
+    if (knap == NULL)
+        return NULL;
+    memset(knap, 0, sizeof(Knapsack));
+    knap->num_threads = 1;
+    knap->engine = KNAP_AUTO;
+    knap->last_engine = KNAP_AUTO;
+    knap->dp_budget = DEFAULT_DP_BUDGET;
+    knap->reduce = TRUE;
+    knap->epsilon = DEFAULT_EPSILON;
+    knap->total = FIRST_BLOCK_SIZE;
+    knap->block = newBlock(knap->total, NULL);
+    if (knap->block == NULL)
+    {
+        free(knap);
+        return NULL;
+    }
+    return knap;
+}
+
+void Knapsack_free(Knapsack *knap)
+{
+    if (knap == NULL)
+        return;
+    stopPool(knap);
+    while (knap->block != NULL)
+    {
+        KnapBlock *prev = knap->block->prev;
+        free(knap->block);
+        knap->block = prev;
+    }
+    free(knap);
+}
+
+/**
+ * dst[c] = max(src[c], src[c - weight] + value) for every c in [from, to), from >= weight
+ */
+static void knapRangeScalar(const long long *src, long long *dst, long long from, long long to,
+                            long long weight, long long value)
+{
+    for (long long c = from; c < to; c++)
+    {
+        long long take = src[c - weight] + value;
+        dst[c] = take > src[c] ? take : src[c];
+    }
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// the same with 8 cells at a time - a shifted load, an add and a max
+__attribute__((target("avx512f"))) static void knapRangeAvx512(const long long *src, long long *dst,
+                                                               long long from, long long to,
+                                                               long long weight, long long value)
+{
+    __m512i add = _mm512_set1_epi64(value);
+    long long c = from;
+    for (; c + 8 <= to; c += 8)
+    {
+        __m512i keep = _mm512_loadu_si512(src + c);
+        __m512i take = _mm512_add_epi64(_mm512_loadu_si512(src + c - weight), add);
+        _mm512_storeu_si512(dst + c, _mm512_max_epi64(keep, take));
+    }
+    knapRangeScalar(src, dst, c, to, weight, value);
+}
+
+// AVX2 has no 64 bit max, so compare and blend instead
+__attribute__((target("avx2"))) static void knapRangeAvx2(const long long *src, long long *dst,
+                                                          long long from, long long to,
+                                                          long long weight, long long value)
+{
+    __m256i add = _mm256_set1_epi64x(value);
+    long long c = from;
+    for (; c + 4 <= to; c += 4)
+    {
+        __m256i keep = _mm256_loadu_si256((const __m256i *)(src + c));
+        __m256i take = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(src + c - weight)), add);
+        __m256i more = _mm256_cmpgt_epi64(take, keep);
+        _mm256_storeu_si256((__m256i *)(dst + c), _mm256_blendv_epi8(keep, take, more));
+    }
+    knapRangeScalar(src, dst, c, to, weight, value);
+}
+#endif
+
+/**
+ * Add one item to the cells [from, to) of a dp row
+ * @param src the best values of the items so far, for every capacity
+ * @param dst the best values with the item too
+ */
+static void knapRange(const long long *src, long long *dst, long long from, long long to,
+                      long long weight, long long value)
+{
+    // If the weight of the item is more than the capacity - we can't take it
+    for (; from < weight && from < to; from++)
+    {
+        dst[from] = src[from];
+    }
+    if (from >= to)
+        return;
+
+    // Choose the maximum value between taking the item and not taking the item
+#if defined(__GNUC__) && defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        knapRangeAvx512(src, dst, from, to, weight, value);
+        return;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        knapRangeAvx2(src, dst, from, to, weight, value);
+        return;
+    }
+#endif
+    knapRangeScalar(src, dst, from, to, weight, value);
+}
+
+/**
+ * The best value of items [lo, hi) for every capacity 0..capacity
+ * The items are added TILE_ITEMS at a time, ROW_BLOCK cells at a time - every
+ * item of the group goes over a block while it is still in L1, and every item
+ * has its own row, so an item reads the row of the item before it
+ * @param rows TILE_ITEMS + 1 rows of capacity + 1 cells, the result is in one of them
+ * @return the row with the result
+ */
+static long long *forwardRowSerial(const long long weights[], const long long values[], int lo, int hi,
+                                   long long capacity, long long *rows[TILE_ITEMS + 1])
+{
+    long long *row[TILE_ITEMS + 1];
+    memcpy(row, rows, sizeof(row));
+    memset(row[0], 0, sizeof(long long) * (capacity + 1));
+
+    int i = lo;
+    while (i < hi)
+    {
+        // the next group of items that fit
+        int group[TILE_ITEMS];
+        int count = 0;
+        for (; i < hi && count < TILE_ITEMS; i++)
+        {
+            if (weights[i] <= capacity)
+                group[count++] = i;
+        }
+
+        for (long long from = 0; from <= capacity; from += ROW_BLOCK)
+        {
+            long long to = capacity + 1 - from > ROW_BLOCK ? from + ROW_BLOCK : capacity + 1;
+            for (int k = 0; k < count; k++)
+            {
+                knapRange(row[k], row[k + 1], from, to, weights[group[k]], values[group[k]]);
+            }
+        }
+
+        // the last row of the group is the first row of the next one
+        long long *tmp = row[0];
+        row[0] = row[count];
+        row[count] = tmp;
+    }
+    return row[0];
+}
+
+//------------------------------------------------
+// threads
+//------------------------------------------------
+
+// the cells [from, to) of the row worker id computes
+static void workerCells(const Knapsack *knap, int id, long long *from, long long *to)
+{
+    long long cells = knap->job.capacity + 1;
+    long long chunk = (cells + knap->num_threads - 1) / knap->num_threads;
+    *from = chunk * id < cells ? chunk * id : cells;
+    *to = *from + chunk < cells ? *from + chunk : cells;
+}
+
+/**
+ * Every item of the job on the cells of one worker, and then a barrier - every
+ * cell of row i depends only on row i - 1, and only the cells below it
+ */
+static void forwardPartBarrier(Knapsack *knap, int id)
+{
+    const KnapJob *job = &knap->job;
+    long long from, to;
+    workerCells(knap, id, &from, &to);
+
+    long long *src = job->rows[0];
+    long long *dst = job->rows[1];
+    memset(src + from, 0, sizeof(long long) * (to - from));
+    pthread_barrier_wait(&knap->barrier);
+
+    for (int i = job->lo; i < job->hi; i++)
+    {
+        if (job->weights[i] > job->capacity)
+            continue;
+        knapRange(src, dst, from, to, job->weights[i], job->values[i]);
+        pthread_barrier_wait(&knap->barrier);
+        long long *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (id == 0)
+        knap->job.result = src;
+}
+
+/**
+ * Every item of the job on the cells of one worker, as a wavefront - the rows
+ * after the last TILE_ITEMS items are kept in a ring, so a worker only waits
+ * for the workers below it to finish the row it reads, and for the workers
+ * above it to finish reading the ring slot it is about to write
+ */
+static void forwardPartWavefront(Knapsack *knap, int id)
+{
+    const KnapJob *job = &knap->job;
+    const int ring = TILE_ITEMS + 1;
+    long long from, to;
+    workerCells(knap, id, &from, &to);
+
+    memset(job->rows[0] + from, 0, sizeof(long long) * (to - from));
+    atomic_store_explicit(&knap->progress[id], 0, memory_order_release);
+
+    int done = 0;
+    for (int i = job->lo; i < job->hi; i++)
+    {
+        long long weight = job->weights[i];
+        if (weight > job->capacity)
+            continue;
+
+        for (int u = 0; u < knap->num_threads && from < to; u++)
+        {
+            long long u_from, u_to;
+            workerCells(knap, u, &u_from, &u_to);
+            // a worker below that owns cells this one reads, or a worker above
+            // that may still read the slot this one writes
+            int need = u < id && u_to > from - weight ? done : u > id ? done + 2 - ring : -1;
+            while (atomic_load_explicit(&knap->progress[u], memory_order_acquire) < need)
+            {
+                sched_yield();
+            }
+        }
+
+        knapRange(job->rows[done % ring], job->rows[(done + 1) % ring], from, to, weight, job->values[i]);
+        done++;
+        atomic_store_explicit(&knap->progress[id], done, memory_order_release);
+    }
+    if (id == 0)
+        knap->job.result = job->rows[done % ring];
+}
+
+static void forwardPart(Knapsack *knap, int id)
+{
+    if (knap->job.capacity + 1 >= WAVEFRONT_CELLS)
+        forwardPartWavefront(knap, id);
+    else
+        forwardPartBarrier(knap, id);
+}
+
+static void *knapWorker(void *arg)
+{
+    KnapWorker *worker = arg;
+    Knapsack *knap = worker->knap;
+    int seen = 0;
+
+    pthread_mutex_lock(&knap->lock);
+    while (TRUE)
+    {
+        while (knap->generation == seen && knap->stop == FALSE)
+        {
+            pthread_cond_wait(&knap->wake, &knap->lock);
+        }
+        if (knap->stop == TRUE)
+            break;
+        seen = knap->generation;
+        pthread_mutex_unlock(&knap->lock);
+
+        forwardPart(knap, worker->id);
+
+        pthread_mutex_lock(&knap->lock);
+        if (--knap->busy == 0)
+            pthread_cond_signal(&knap->idle);
+    }
+    pthread_mutex_unlock(&knap->lock);
+    return NULL;
+}
+
+static void stopPool(Knapsack *knap)
+{
+    if (knap->num_threads <= 1)
+        return;
+
+    pthread_mutex_lock(&knap->lock);
+    knap->stop = TRUE;
+    pthread_cond_broadcast(&knap->wake);
+    pthread_mutex_unlock(&knap->lock);
+    for (int t = 1; t < knap->num_threads; t++)
+    {
+        pthread_join(knap->workers[t].thread, NULL);
+    }
+
+    pthread_barrier_destroy(&knap->barrier);
+    pthread_cond_destroy(&knap->idle);
+    pthread_cond_destroy(&knap->wake);
+    pthread_mutex_destroy(&knap->lock);
+    free(knap->workers);
+    free(knap->progress);
+    knap->workers = NULL;
+    knap->progress = NULL;
+    knap->num_threads = 1;
+}
+
+int Knapsack_setThreads(Knapsack *knap, int num_threads)
+{
+    stopPool(knap);
+    if (num_threads <= 1)
+        return TRUE;
+
+    knap->workers = malloc(sizeof(KnapWorker) * num_threads);
+    knap->progress = malloc(sizeof(atomic_int) * num_threads);
+    if (knap->workers == NULL || knap->progress == NULL)
+    {
+        free(knap->workers);
+        free(knap->progress);
+        knap->workers = NULL;
+        knap->progress = NULL;
+        return FALSE;
+    }
+
+    pthread_mutex_init(&knap->lock, NULL);
+    pthread_cond_init(&knap->wake, NULL);
+    pthread_cond_init(&knap->idle, NULL);
+    pthread_barrier_init(&knap->barrier, NULL, num_threads);
+    knap->generation = 0;
+    knap->busy = 0;
+    knap->stop = FALSE;
+    knap->num_threads = num_threads;
+
+    for (int t = 0; t < num_threads; t++)
+    {
+        knap->workers[t].knap = knap;
+        knap->workers[t].id = t;
+        if (t > 0 && pthread_create(&knap->workers[t].thread, NULL, knapWorker, &knap->workers[t]) != 0)
+        {
+            // the barrier waits for all of them, so no pool at all
+            knap->num_threads = t;
+            stopPool(knap);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+int Knapsack_threads(const Knapsack *knap)
+{
+    return knap->num_threads;
+}
+
+/**
+ * The best value of items [lo, hi) for every capacity 0..capacity, on all the
+ * threads of the pool when the row is long enough - the same row as alone
+ * @param rows TILE_ITEMS + 1 rows of capacity + 1 cells, the result is in one of them
+ * @return the row with the result
+ */
+static long long *forwardRow(Knapsack *knap, const long long weights[], const long long values[], int lo, int hi,
+                             long long capacity, long long *rows[TILE_ITEMS + 1])
+{
+    if (knap->num_threads <= 1 || capacity + 1 < PARALLEL_CELLS)
+        return forwardRowSerial(weights, values, lo, hi, capacity, rows);
+
+    KnapJob job = {weights, values, lo, hi, capacity, rows, NULL};
+    for (int t = 0; t < knap->num_threads; t++)
+    {
+        atomic_init(&knap->progress[t], -1);
+    }
+
+    pthread_mutex_lock(&knap->lock);
+    knap->job = job;
+    knap->busy = knap->num_threads - 1;
+    knap->generation++;
+    pthread_cond_broadcast(&knap->wake);
+    pthread_mutex_unlock(&knap->lock);
+
+    forwardPart(knap, 0);
+
+    pthread_mutex_lock(&knap->lock);
+    while (knap->busy > 0)
+    {
+        pthread_cond_wait(&knap->idle, &knap->lock);
+    }
+    pthread_mutex_unlock(&knap->lock);
+    return knap->job.result;
+}
+
+/**
+ * Solve items [lo, hi) with a full table, like the first version of the solver
+ * @return FALSE if there is not enough memory
+ */
+static int solveTable(Knapsack *knap, const long long weights[], const long long values[], int lo, int hi,
+                      long long capacity, int selected[])
+{
+    int count = hi - lo;
+    long long width = capacity + 1;
+    KnapMark mark = knapMark(knap);
+    long long *dp = knapTake(knap, sizeof(long long) * (count + 1) * width);
+    if (dp == NULL)
+        return FALSE;
+
+    // Base case - if there are no items the value is 0
+    memset(dp, 0, sizeof(long long) * width);
+    for (int i = 1; i <= count; i++)
+    {
+        knapRange(dp + (i - 1) * width, dp + i * width, 0, width, weights[lo + i - 1], values[lo + i - 1]);
+    }
+
+    // Find the selected items - we start from the last item and go back
+    long long B = capacity;
+    for (int i = count; i > 0; i--)
+    {
+        // If the value is different from the value of the previous item - it means we took the item
+        if (dp[i * width + B] != dp[(i - 1) * width + B])
+        {
+            selected[lo + i - 1] = TRUE;
+            B -= weights[lo + i - 1];
+        }
+    }
+
+    knapRelease(knap, mark);
+    return TRUE;
+}
+
+/**
+ * Find the selected items of [lo, hi) in O(capacity) memory - the best value is
+ * split between the two halves of the items at some capacity c, found from the
+ * last rows of both halves, and then each half is solved on its own
+ * @return FALSE if there is not enough memory
+ */
+static int solveRange(Knapsack *knap, const long long weights[], const long long values[], int lo, int hi,
+                      long long capacity, int selected[])
+{
+    if (hi <= lo)
+        return TRUE;
+    if (capacity + 1 <= TABLE_CELLS / (hi - lo + 1))
+        return solveTable(knap, weights, values, lo, hi, capacity, selected);
+    if (hi - lo == 1)
+    {
+        selected[lo] = weights[lo] <= capacity && values[lo] > 0 ? TRUE : FALSE;
+        return TRUE;
+    }
+
+    KnapMark mark = knapMark(knap);
+    size_t row_size = sizeof(long long) * (capacity + 1);
+    long long *rows[TILE_ITEMS + 1];
+    for (int k = 0; k <= TILE_ITEMS; k++)
+    {
+        rows[k] = knapTake(knap, row_size);
+        if (rows[k] == NULL)
+            return FALSE;
+    }
+    long long *left = knapTake(knap, row_size);
+    if (left == NULL)
+        return FALSE;
+
+    // keep the last row of the first half out of the rows the second half uses
+    int mid = lo + (hi - lo) / 2;
+    long long *first = forwardRow(knap, weights, values, lo, mid, capacity, rows);
+    for (int k = 0; k <= TILE_ITEMS; k++)
+    {
+        if (rows[k] == first)
+        {
+            rows[k] = left;
+            left = first;
+        }
+    }
+    long long *right = forwardRow(knap, weights, values, mid, hi, capacity, rows);
+
+    long long split = 0;
+    long long best = -1;
+    for (long long c = 0; c <= capacity; c++)
+    {
+        if (left[c] + right[capacity - c] > best)
+        {
+            best = left[c] + right[capacity - c];
+            split = c;
+        }
+    }
+
+    knapRelease(knap, mark);
+    return solveRange(knap, weights, values, lo, mid, split, selected) &&
+           solveRange(knap, weights, values, mid, hi, capacity - split, selected);
+}
+
+int knapSolveDp(Knapsack *knap, int n, const long long weights[], const long long values[],
+                long long capacity, int selected[])
+{
+    if (capacity >= (long long)(SIZE_MAX / sizeof(long long) / (TILE_ITEMS + 2)))
+        return FALSE;
+    return solveRange(knap, weights, values, 0, n, capacity, selected);
+}
+
+void Knapsack_setEngine(Knapsack *knap, int engine)
+{
+    knap->engine = engine;
+}
+
+int Knapsack_lastEngine(const Knapsack *knap)
+{
+    return knap->last_engine;
+}
+
+void Knapsack_setDpBudget(Knapsack *knap, long long cells)
+{
+    knap->dp_budget = cells;
+}
+
+void Knapsack_setReduce(Knapsack *knap, int reduce)
+{
+    knap->reduce = reduce;
+}
+
+int Knapsack_setEpsilon(Knapsack *knap, double epsilon)
+{
+    if (!(epsilon > 0 && epsilon < 1))
+        return FALSE;
+    knap->epsilon = epsilon;
+    return TRUE;
+}
+
+double knapEpsilon(const Knapsack *knap)
+{
+    return knap->epsilon;
+}
+
+/**
+ * The engine KNAP_AUTO takes - the cheapest of the dp over the capacities
+ * (dp_items rows of capacity + 1 cells), the dp over the values (a row of the
+ * sum of the values + 1 cells per item) while they are within the dp budget,
+ * and meet in the middle (2^(useful / 2) sums per half) for up to 40 items.
+ * Branch and bound if there is none of them - it gives up past its own budget
+ * of nodes and pairs, and solveItems goes on to the sparse dp then.
+ */
+static int chooseEngine(const Knapsack *knap, int dp_items, int n, const long long weights[],
+                        const long long values[], long long capacity)
+{
+    // the items the engines look at, and what they are worth together (up to the budget)
+    long long budget = knap->dp_budget;
+    int useful = 0;
+    long long total = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (values[i] > 0 && weights[i] > 0 && weights[i] <= capacity)
+        {
+            useful++;
+            total = values[i] > budget - total ? budget : total + values[i];
+        }
+    }
+
+    long long rows = dp_items > 0 ? dp_items : 1;
+    long long weight_cells = capacity + 1 <= budget / rows ? rows * (capacity + 1) : -1;
+    long long value_rows = useful > 0 ? useful : 1;
+    long long value_cells = total + 1 <= budget / value_rows ? value_rows * (total + 1) : -1;
+    long long mitm_sums = useful <= MITM_MAX_ITEMS ? useful * (1LL << (useful + 1) / 2) : -1;
+
+    // a single table is as cheap as it gets
+    if (weight_cells >= 0 && weight_cells <= TABLE_CELLS)
+        return KNAP_DP;
+
+    int engine = KNAP_BNB;
+    long long cost = -1;
+    if (weight_cells >= 0)
+    {
+        engine = KNAP_DP;
+        cost = weight_cells;
+    }
+    if (value_cells >= 0 && (cost < 0 || value_cells < cost))
+    {
+        engine = KNAP_VALUE_DP;
+        cost = value_cells;
+    }
+    if (mitm_sums >= 0 && (cost < 0 || mitm_sums < cost))
+        engine = KNAP_MITM;
+    return engine;
+}
+
+static int solveItems(Knapsack *knap, int engine, int n, const long long weights[], const long long values[],
+                      long long capacity, int selected[])
+{
+    knap->last_engine = engine;
+    if (engine == KNAP_BNB)
+    {
+        KnapMark mark = knapMark(knap);
+        if (knapSolveBnb(knap, n, weights, values, capacity, selected) == TRUE)
+            return TRUE;
+        if (knap->engine != KNAP_AUTO)
+            return FALSE;
+
+        // KNAP_AUTO's last try - the sparse dp, within the dp budget
+        knapRelease(knap, mark);
+        for (int i = 0; i < n; i++)
+        {
+            selected[i] = FALSE;
+        }
+        knap->last_engine = KNAP_PARETO;
+        return knapPareto(knap, n, weights, values, capacity, knap->dp_budget / PARETO_PAIR_CELLS, selected);
+    }
+    if (engine == KNAP_MITM)
+        return knapSolveMitm(knap, n, weights, values, capacity, selected);
+    if (engine == KNAP_VALUE_DP)
+        return knapSolveValueDp(knap, n, weights, values, capacity, selected);
+    if (engine == KNAP_FPTAS)
+        return knapSolveFptas(knap, n, weights, values, capacity, selected);
+    if (engine == KNAP_PARETO)
+        return knapSolvePareto(knap, n, weights, values, capacity, selected);
+    return knapSolveDp(knap, n, weights, values, capacity, selected);
+}
+
+/**
+ * Solve what knapReduce leaves of the instance. The dp takes the groups of
+ * equal items as they are, with their counts (one bounded row per group), the
+ * other engines get one item per copy again.
+ */
+static int solveReduced(Knapsack *knap, int n, const long long weights[], const long long values[],
+                        long long capacity, int selected[])
+{
+    KnapReduction reduction;
+    if (knapReduce(knap, n, weights, values, capacity, selected, &reduction) == FALSE)
+        return FALSE;
+
+    int num_free = reduction.num_free;
+    int copies = 0;
+    for (int k = 0; k < num_free; k++)
+    {
+        copies += (int)reduction.counts[k];
+    }
+    long long *taken = knapTake(knap, sizeof(long long) * (num_free + 1));
+    long long *item_weights = knapTake(knap, sizeof(long long) * (copies + 1));
+    long long *item_values = knapTake(knap, sizeof(long long) * (copies + 1));
+    int *item_group = knapTake(knap, sizeof(int) * (copies + 1));
+    int *item_selected = knapTake(knap, sizeof(int) * (copies + 1));
+    if (taken == NULL || item_weights == NULL || item_values == NULL || item_group == NULL || item_selected == NULL)
+        return FALSE;
+    for (int k = 0, i = 0; k < num_free; k++)
+    {
+        taken[k] = 0;
+        for (long long c = 0; c < reduction.counts[k]; c++, i++)
+        {
+            item_weights[i] = reduction.weights[k];
+            item_values[i] = reduction.values[k];
+            item_group[i] = k;
+            item_selected[i] = FALSE;
+        }
+    }
+
+    int engine = knap->engine;
+    if (engine == KNAP_AUTO)
+        engine = chooseEngine(knap, num_free, copies, item_weights, item_values, reduction.capacity);
+    if (engine == KNAP_DP && copies > num_free)
+    {
+        knap->last_engine = engine;
+        if (knapSolveBoundedItems(knap, num_free, reduction.weights, reduction.values, reduction.counts,
+                                  reduction.capacity, taken) == FALSE)
+            return FALSE;
+    }
+    else
+    {
+        if (solveItems(knap, engine, copies, item_weights, item_values, reduction.capacity, item_selected) == FALSE)
+            return FALSE;
+        for (int i = 0; i < copies; i++)
+        {
+            if (item_selected[i] == TRUE)
+                taken[item_group[i]]++;
+        }
+    }
+
+    knapApplyReduction(&reduction, taken, selected);
+    return TRUE;
+}
+
+long long Knapsack_solve(Knapsack *knap, int n, const long long weights[], const long long values[],
+                         long long capacity, int selected[])
+{
+    // Initialize the selected items array to false
+    for (int i = 0; i < n; i++)
+    {
+        selected[i] = FALSE;
+    }
+    if (n < 0 || capacity < 0)
+        return -1;
+
+    long long max_value = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (weights[i] < 0 || values[i] < 0)
+            return -1;
+    }
+
+    // a single table is solved before the reduction would be done
+    int ok;
+    if (knap->reduce == TRUE && capacity + 1 > TABLE_CELLS / (n + 1))
+    {
+        ok = solveReduced(knap, n, weights, values, capacity, selected);
+    }
+    else
+    {
+        int engine = knap->engine;
+        if (engine == KNAP_AUTO)
+            engine = chooseEngine(knap, n, n, weights, values, capacity);
+        ok = solveItems(knap, engine, n, weights, values, capacity, selected);
+    }
+    knapReset(knap);
+    if (ok == FALSE)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            selected[i] = FALSE;
+        }
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (selected[i] == TRUE)
+            max_value += values[i];
+    }
+    return max_value;
+}
+
+// the instances Knapsack_solveAll hands out to its workers, one index at a time
+typedef struct
+{
+    KnapInstance *instances;
+    int count;
+    atomic_int next_index;
+} KnapBatch;
+
+// a worker of Knapsack_solveAll and the solver it keeps for itself
+typedef struct
+{
+    pthread_t thread;
+    KnapBatch *batch;
+    Knapsack *knap;
+} KnapBatchWorker;
+
+static void *solveAllWorker(void *arg)
+{
+    KnapBatchWorker *worker = arg;
+    KnapBatch *batch = worker->batch;
+    int i;
+    while ((i = atomic_fetch_add(&batch->next_index, 1)) < batch->count)
+    {
+        KnapInstance *instance = &batch->instances[i];
+        instance->max_value = Knapsack_solve(worker->knap, instance->n, instance->weights, instance->values,
+                                             instance->capacity, instance->selected);
+    }
+    return NULL;
+}
+
+void Knapsack_solveAll(Knapsack *solvers[], int num_solvers, KnapInstance instances[], int count)
+{
+    KnapBatch batch;
+    batch.instances = instances;
+    batch.count = count;
+    atomic_init(&batch.next_index, 0);
+
+    if (num_solvers > count)
+        num_solvers = count;
+
+    // the calling thread is one of the workers, with solvers[0]
+    KnapBatchWorker workers[num_solvers > 0 ? num_solvers : 1];
+    int started = 1;
+    for (; started < num_solvers; started++)
+    {
+        workers[started].batch = &batch;
+        workers[started].knap = solvers[started];
+        if (pthread_create(&workers[started].thread, NULL, solveAllWorker, &workers[started]) != 0)
+            break;
+    }
+    workers[0].batch = &batch;
+    workers[0].knap = solvers[0];
+    solveAllWorker(&workers[0]);
+
+    for (int t = 1; t < started; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+    }
+}
@@ -0,0 +1,175 @@
+#include <stddef.h>
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+/*
+ * Knapsack - a 0/1 knapsack solver.
+ * Every solver keeps its dp rows in its own memory and reuses it on the next
+ * solve, so keep one solver per thread and solve many instances with it.
+ */
+struct _Knapsack;
+typedef struct _Knapsack Knapsack;
+
+Knapsack *Knapsack_alloc();
+void Knapsack_free(Knapsack *knap);
+
+/*
+ * Splits the capacities of every dp row between num_threads threads (the
+ * calling one too), kept by the solver until the next call or Knapsack_free.
+ * The items selected are the same as with one thread.
+ * Returns FALSE if the threads can't be started - the solver is left with one.
+ */
+int Knapsack_setThreads(Knapsack *knap, int num_threads);
+int Knapsack_threads(const Knapsack *knap);
+
+/*
+ * The engines Knapsack_solve can use, every one but KNAP_FPTAS finds an optimal solution:
+ *   KNAP_DP   - dp over the capacities, n * capacity time. It keeps only rows of
+ *               capacity + 1 cells - the items are found again by splitting them
+ *               in half and solving every half on its own (Hirschberg)
+ *   KNAP_BNB  - branch and bound from the greedy solution (Pisinger's expknap),
+ *               fast on most instances whatever the capacity. When it looks at
+ *               too many nodes a core of the items around the break item is
+ *               solved with the sparse dp instead (minknap), and past a budget
+ *               of pairs it fails rather than run on
+ *   KNAP_MITM - meet in the middle, 2^(n/2) sums of each half of the items for
+ *               up to 40 items (that fit and are worth something) of any weight
+ *   KNAP_VALUE_DP - dp over the values, the least weight for every value,
+ *               n * (sum of the values) time - for heavy items that aren't worth
+ *               much. The items are found again the same way
+ *   KNAP_PARETO - the sparse dp (Nemhauser - Ullmann) - only the (weight, value)
+ *               pairs no lighter pair is worth as much as, merged with every item
+ *               in time and memory of the number of them, whatever the capacity.
+ *               Fast when there are few of them - at most 2^n, or capacity + 1
+ *   KNAP_FPTAS - not optimal - at least (1 - epsilon) of the optimum, with
+ *               the value dp on values rounded down to multiples of about
+ *               epsilon * optimum / n, O(n^2 / epsilon) time. KNAP_AUTO never
+ *               takes it
+ *   KNAP_AUTO - the cheapest of the two dps (while within the dp budget, 2^32
+ *               cells by default) and meet in the middle for up to 40 items,
+ *               branch and bound if there is none of them, and the sparse dp
+ *               if that gives up (on a 16th of the dp budget in pairs). -1 if
+ *               it does too (the default)
+ */
+#define KNAP_AUTO 0
+#define KNAP_DP 1
+#define KNAP_BNB 2
+#define KNAP_MITM 3
+#define KNAP_VALUE_DP 4
+#define KNAP_FPTAS 5
+#define KNAP_PARETO 6
+
+void Knapsack_setEngine(Knapsack *knap, int engine);
+void Knapsack_setDpBudget(Knapsack *knap, long long cells);
+// KNAP_FPTAS' epsilon, 0.1 by default - FALSE if it isn't in (0, 1)
+int Knapsack_setEpsilon(Knapsack *knap, double epsilon);
+
+// the engine the last Knapsack_solve used - what KNAP_AUTO chose
+int Knapsack_lastEngine(const Knapsack *knap);
+
+/*
+ * Before the engine every solve (but the smallest) reduces the instance - the
+ * items that can't be in an optimal solution (too heavy, worth nothing, or
+ * dominated by lighter items worth more that don't all fit together with
+ * them) are dropped, equal items are grouped, and the items the greedy
+ * solution's bounds decide (Dembo - Hammer) are fixed, so the engine gets
+ * fewer items and less capacity. On by default, FALSE gives the engine the
+ * instance as it is.
+ */
+void Knapsack_setReduce(Knapsack *knap, int reduce);
+
+/*
+ * Solves the knapsack of n items with weights[i] and values[i] (both >= 0) and
+ * the given capacity. selected[i] is set to TRUE for the items taken.
+ * Returns the maximum value, -1 if the input is invalid, there is not enough
+ * memory or the engine can't take that many items.
+ */
+long long Knapsack_solve(Knapsack *knap, int n, const long long weights[], const long long values[],
+                         long long capacity, int selected[]);
+
+/*
+ * One instance of Knapsack_solveAll - max_value and selected are its answer.
+ */
+typedef struct
+{
+    int n;
+    const long long *weights;
+    const long long *values;
+    long long capacity;
+    int *selected;
+    long long max_value;
+} KnapInstance;
+
+/*
+ * Solves every instance with Knapsack_solve, on one thread per solver (the
+ * calling one with solvers[0]). Every thread keeps to its own solver, so the
+ * solvers' memory is reused from one instance to the next and from one call
+ * to the next without locks.
+ */
+void Knapsack_solveAll(Knapsack *solvers[], int num_solvers, KnapInstance instances[], int count);
+
+/*
+ * The bounded knapsack - item i can be taken up to counts[i] times, or any
+ * number of times for KNAP_UNBOUNDED. taken[i] is set to the times item i is taken.
+ * Every item costs O(capacity) whatever its count (a sliding window maximum
+ * over the cells one weight apart, one forward pass for the unbounded ones),
+ * and the counts are found again like Knapsack_solve's items, in O(capacity) memory.
+ * Returns the maximum value, -1 if the input is invalid or there is not enough memory.
+ */
+#define KNAP_UNBOUNDED -1
+
+long long Knapsack_solveBounded(Knapsack *knap, int n, const long long weights[], const long long values[],
+                                const long long counts[], long long capacity, long long taken[]);
+
+
+/*
+ * KnapStack - a knapsack of a fixed capacity the items are added to one at a
+ * time. It keeps the dp row after every item, so adding one is O(capacity),
+ * taking the last one out is O(1) and the best value for any capacity up to
+ * its own is O(1). Taking out item index does the rows above it again,
+ * O((size - index) * capacity) - for many removals see Knapsack_solveOps.
+ */
+struct _KnapStack;
+typedef struct _KnapStack KnapStack;
+
+KnapStack *KnapStack_alloc(long long capacity);
+void KnapStack_free(KnapStack *stack);
+
+// both return FALSE for an invalid item / index or not enough memory
+int KnapStack_push(KnapStack *stack, long long weight, long long value);
+int KnapStack_remove(KnapStack *stack, int index);
+void KnapStack_pop(KnapStack *stack);
+int KnapStack_size(const KnapStack *stack);
+
+// the best value within capacity (at most the stack's), -1 for a negative capacity
+long long KnapStack_best(const KnapStack *stack, long long capacity);
+// the same, and selected[i] set for the items of it, in O(size)
+long long KnapStack_select(const KnapStack *stack, long long capacity, int selected[]);
+
+/*
+ * Items that come and go, known in advance - every KNAP_QUERY op gets the best
+ * value of the items added and not removed yet before it, within its capacity
+ * (at most the capacity of the solve). KNAP_REMOVE removes the item of the
+ * KNAP_ADD op at index item.
+ * Every item is added to O(log queries) dp rows of capacity + 1 cells, and
+ * there are only log(queries) rows at a time.
+ * Returns FALSE if an op is invalid or there is not enough memory.
+ */
+#define KNAP_ADD 0
+#define KNAP_REMOVE 1
+#define KNAP_QUERY 2
+
+typedef struct
+{
+    int type;
+    long long weight;   // KNAP_ADD
+    long long value;    // KNAP_ADD
+    int item;           // KNAP_REMOVE
+    long long capacity; // KNAP_QUERY
+    long long answer;   // KNAP_QUERY, set by the solve
+} KnapOp;
+
+int Knapsack_solveOps(Knapsack *knap, long long capacity, KnapOp ops[], int count);
@@ -0,0 +1,138 @@
+#include "my_knap.h"
+
+// the most items (that fit and are worth something) meet in the middle takes
+#define MITM_MAX_ITEMS 40
+
+/*
+ * Shared by the files of the knapsack solver - not part of the API.
+ */
+
+// a point in the solver's memory to go back to
+typedef struct
+{
+    struct _KnapBlock *block;
+    size_t used;
+} KnapMark;
+
+/*
+ * Memory of the solver for the current solve, cache line aligned, NULL if there is none.
+ * Everything taken is given back at the end of the solve, or before with knapRelease.
+ */
+void *knapTake(Knapsack *knap, size_t size);
+KnapMark knapMark(const Knapsack *knap);
+void knapRelease(Knapsack *knap, KnapMark mark);
+
+// the end of a solve - gives back everything
+void knapReset(Knapsack *knap);
+
+/*
+ * The engines - every one sets selected[i] to TRUE for the items of an optimal
+ * solution (selected is all FALSE on entry) and returns FALSE if there is not
+ * enough memory (or too many items for it). The items are valid: weights and values >= 0, capacity >= 0.
+ */
+int knapSolveDp(Knapsack *knap, int n, const long long weights[], const long long values[],
+                long long capacity, int selected[]);
+int knapSolveBnb(Knapsack *knap, int n, const long long weights[], const long long values[],
+                 long long capacity, int selected[]);
+int knapSolveMitm(Knapsack *knap, int n, const long long weights[], const long long values[],
+                  long long capacity, int selected[]);
+int knapSolveValueDp(Knapsack *knap, int n, const long long weights[], const long long values[],
+                     long long capacity, int selected[]);
+int knapSolveFptas(Knapsack *knap, int n, const long long weights[], const long long values[],
+                   long long capacity, int selected[]);
+int knapSolvePareto(Knapsack *knap, int n, const long long weights[], const long long values[],
+                    long long capacity, int selected[]);
+
+// the value dp with rows of at most limit + 1 cells - exact as long as the
+// optimum is at most limit
+int knapValueDp(Knapsack *knap, int n, const long long weights[], const long long values[],
+                long long capacity, long long limit, int selected[]);
+
+// the Pareto engine that merges at most budget pairs over all the items - FALSE past them
+int knapPareto(Knapsack *knap, int n, const long long weights[], const long long values[],
+               long long capacity, long long budget, int selected[]);
+
+/*
+ * The pairs of the sparse dps (the Pareto engine and the core of the branch and
+ * bound) - a (weight, value) pair and the link of the last item it changed, -1
+ * for none. Following the links back gives every item the pair changed.
+ */
+typedef struct
+{
+    long long weight;
+    long long value;
+    int link;
+} KnapState;
+
+// item was changed, on top of the pair of link prev
+typedef struct
+{
+    int prev;
+    int item;
+} KnapLink;
+
+// the links of a sparse dp, grown with realloc
+typedef struct
+{
+    KnapLink *links;
+    size_t num_links;
+    size_t room;
+    size_t compact_at;
+    int *place;
+} KnapLinks;
+
+int knapLinksInit(KnapLinks *links);
+void knapLinksFree(KnapLinks *links);
+// a new link, -1 if there is not enough memory
+int knapLinkNew(KnapLinks *links, int prev, int item);
+// drops the links none of the size pairs of states leads to, once there are
+// enough of them - returns FALSE if there is not enough memory
+int knapLinksCompact(KnapLinks *links, KnapState states[], int size);
+
+// the fptas' epsilon of the solver
+double knapEpsilon(const Knapsack *knap);
+
+// Knapsack_solveBounded's engine - taken[i] is set for every item
+int knapSolveBoundedItems(Knapsack *knap, int n, const long long weights[], const long long values[],
+                          const long long counts[], long long capacity, long long taken[]);
+
+// the items of the same weight and value, members[first .. first + count) of the reduction
+typedef struct
+{
+    long long weight;
+    long long value;
+    long long count;
+    int first;
+} KnapGroup;
+
+/*
+ * What is left of an instance for the engines after knapReduce - num_free groups
+ * with weights (divided by a common factor), values and counts, and the capacity
+ * left for them. incumbent is the greedy solution's count of every group.
+ */
+typedef struct
+{
+    KnapGroup *groups;
+    int num_groups;
+    int *members;
+    long long *incumbent;
+    long long incumbent_value;
+    long long fixed_value;
+
+    int num_free;
+    int *free_groups;
+    long long *weights;
+    long long *values;
+    long long *counts;
+    long long capacity;
+} KnapReduction;
+
+/*
+ * Sets selected[i] for the items that are surely taken, groups the rest and
+ * leaves the ones that still need an engine in reduction. Returns FALSE if there
+ * is not enough memory. knapApplyReduction adds the engine's counts of the free
+ * groups to selected (or the greedy solution if it is better after all).
+ */
+int knapReduce(Knapsack *knap, int n, const long long weights[], const long long values[],
+               long long capacity, int selected[], KnapReduction *reduction);
+void knapApplyReduction(const KnapReduction *reduction, const long long taken[], int selected[]);
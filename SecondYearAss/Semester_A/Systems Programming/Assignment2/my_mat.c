@@ -1,64 +1,884 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "my_mat.h"
 
-int dp[N][N];
-int next[N][N];
-int need_update = TRUE;
+// next[i][j] is the node after i on the shortest path from i to j,
+// stored in 16 bits while the graph has less than 65536 nodes
+#define NO_NEXT16 UINT16_MAX
+#define NO_NEXT32 UINT32_MAX
 
-void setup(int mat[N][N])
+struct _Graph
 {
-    // init dp and add the length to next
-    for (int i = 0; i < N; ++i)
+    int n;
+    GraphAllocator allocator;
+
+    // the loaded matrix, n * n row by row
+    int *mat;
+
+    // dp is stored in the narrowest type that can hold the longest simple path,
+    // (n - 1) * max |weight|, so small weights cost 2 bytes per cell instead of 8.
+    // dp and next point to dp_owned / next_owned, or into a mapped snapshot file
+    int dp_bits;
+    void *dp;
+    void *dp_owned;
+    size_t dp_owned_size;
+
+    int next_bits;
+    void *next;
+    void *next_owned;
+
+    // reachability bitsets - one row of words per node (REACH_CLOSURE),
+    // or per strongly connected component (REACH_SCC)
+    int reach_engine;
+    int words;
+    uint64_t *reach;
+
+    // REACH_SCC - the component of every node, and Tarjan's work arrays
+    int num_comps;
+    int comp_words;
+    int *comp;
+    int *scc_work;
+
+    // which of dp / reach are up to date with mat
+    int dp_ready;
+    int reach_ready;
+
+    // snapshot file of the last floydWarshall result, NULL if not used
+    const char *snapshot_path;
+    void *snapshot_map;
+    size_t snapshot_size;
+};
+
+//------------------------------------------------
+// Allocators
+//------------------------------------------------
+
+static void *mallocAlloc(void *ctx, size_t size)
+{
+    (void)ctx;
+    return malloc(size);
+}
+
+static void mallocFree(void *ctx, void *ptr)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+static void *arenaAlloc(void *ctx, size_t size)
+{
+    GraphArena *arena = ctx;
+
+    // keep every block cache line aligned
+    size_t start = (arena->used + 63) & ~(size_t)63;
+    if (start > arena->size || size > arena->size - start)
+        return NULL;
+
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+static void arenaFree(void *ctx, void *ptr)
+{
+    // arena memory is only released all at once, by GraphArena_reset
+    (void)ctx;
+    (void)ptr;
+}
+
+void GraphArena_init(GraphArena *arena, void *buffer, size_t size)
+{
+    // align the base so the blocks are aligned in memory and not only in the buffer
+    uintptr_t base = ((uintptr_t)buffer + 63) & ~(uintptr_t)63;
+    size_t skip = base - (uintptr_t)buffer;
+
+    arena->base = (char *)base;
+    arena->size = size > skip ? size - skip : 0;
+    arena->used = 0;
+}
+
+void GraphArena_reset(GraphArena *arena)
+{
+    arena->used = 0;
+}
+
+GraphAllocator GraphArena_allocator(GraphArena *arena)
+{
+    GraphAllocator allocator = {arenaAlloc, arenaFree, arena};
+    return allocator;
+}
+
+static void *graphAlloc(Graph *graph, size_t size)
+{
+    return graph->allocator.alloc(graph->allocator.ctx, size);
+}
+
+static void graphFree(Graph *graph, void *ptr)
+{
+    if (ptr != NULL)
+        graph->allocator.free(graph->allocator.ctx, ptr);
+}
+
+//------------------------------------------------
+// Graph
+//------------------------------------------------
+
+Graph *Graph_alloc(int n, const GraphAllocator *allocator)
+{
+    GraphAllocator use = {mallocAlloc, mallocFree, NULL};
+    if (allocator != NULL)
+        use = *allocator;
+
+    if (n <= 0)
+        return NULL;
+
+    Graph *graph = use.alloc(use.ctx, sizeof(Graph));
+    if (graph == NULL)
+        return NULL;
+
+    memset(graph, 0, sizeof(Graph));
+    graph->n = n;
+    graph->allocator = use;
+    graph->dp_bits = 32;
+    graph->next_bits = n < 65536 ? 16 : 32;
+    graph->words = (n + 63) / 64;
+    graph->reach_engine = REACH_SCC;
+
+    // dp is allocated by Graph_load, once we know how wide it has to be
+    graph->mat = graphAlloc(graph, sizeof(int) * n * n);
+    graph->next_owned = graphAlloc(graph, (size_t)graph->next_bits / 8 * n * n);
+    graph->reach = graphAlloc(graph, sizeof(uint64_t) * n * graph->words);
+    graph->comp = graphAlloc(graph, sizeof(int) * n);
+    graph->scc_work = graphAlloc(graph, sizeof(int) * 6 * n);
+    if (graph->mat == NULL || graph->next_owned == NULL || graph->reach == NULL ||
+        graph->comp == NULL || graph->scc_work == NULL)
     {
-        for (int j = 0; j < N; ++j)
+        Graph_free(graph);
+        return NULL;
+    }
+
+    graph->next = graph->next_owned;
+    memset(graph->mat, 0, sizeof(int) * n * n);
+    return graph;
+}
+
+// stop using the mapped snapshot (if any) and go back to our own matrices
+static void unmapSnapshot(Graph *graph)
+{
+    if (graph->snapshot_map != NULL)
+    {
+        munmap(graph->snapshot_map, graph->snapshot_size);
+        graph->snapshot_map = NULL;
+        graph->snapshot_size = 0;
+    }
+    graph->dp = graph->dp_owned;
+    graph->next = graph->next_owned;
+}
+
+void Graph_free(Graph *graph)
+{
+    if (graph == NULL)
+        return;
+
+    unmapSnapshot(graph);
+    graphFree(graph, graph->mat);
+    graphFree(graph, graph->dp_owned);
+    graphFree(graph, graph->next_owned);
+    graphFree(graph, graph->reach);
+    graphFree(graph, graph->comp);
+    graphFree(graph, graph->scc_work);
+    graphFree(graph, graph);
+}
+
+int Graph_size(const Graph *graph)
+{
+    return graph->n;
+}
+
+// pick the width of dp by the longest path the matrix can produce
+static int pickWidth(const int *mat, int n)
+{
+    uint64_t max_weight = 0;
+    for (size_t i = 0; i < (size_t)n * n; ++i)
+    {
+        uint64_t w = mat[i] < 0 ? -(int64_t)mat[i] : mat[i];
+        if (w > max_weight)
+            max_weight = w;
+    }
+
+    uint64_t longest = (uint64_t)(n - 1) * max_weight;
+    if (longest <= INT16_MAX)
+        return 16;
+    if (longest <= INT32_MAX)
+        return 32;
+    return 64;
+}
+
+int Graph_load(Graph *graph, const int *mat)
+{
+    int n = graph->n;
+
+    unmapSnapshot(graph);
+    memcpy(graph->mat, mat, sizeof(int) * n * n);
+    graph->dp_ready = FALSE;
+    graph->reach_ready = FALSE;
+
+    // make sure dp has room for the width this matrix needs
+    graph->dp_bits = pickWidth(mat, n);
+    size_t dp_size = (size_t)graph->dp_bits / 8 * n * n;
+    if (dp_size > graph->dp_owned_size)
+    {
+        graphFree(graph, graph->dp_owned);
+        graph->dp_owned = graphAlloc(graph, dp_size);
+        graph->dp_owned_size = graph->dp_owned == NULL ? 0 : dp_size;
+    }
+    graph->dp = graph->dp_owned;
+
+    return graph->dp_owned != NULL ? TRUE : FALSE;
+}
+
+/*
+ * One Floyd-Warshall kernel for every width of dp and next.
+ * Sums go through a saturating add so that a path can never wrap around
+ * into a small (or 0 - "no path") distance.
+ */
+#define DEFINE_SAT_ADD(BITS, MIN, MAX)                                   \
+    static int##BITS##_t satAdd##BITS(int##BITS##_t a, int##BITS##_t b) \
+    {                                                                    \
+        int64_t sum;                                                     \
+        if (__builtin_add_overflow((int64_t)a, (int64_t)b, &sum))        \
+            return a < 0 ? MIN : MAX;                                    \
+        return sum > MAX ? MAX : (sum < MIN ? MIN : (int##BITS##_t)sum); \
+    }
+
+DEFINE_SAT_ADD(16, INT16_MIN, INT16_MAX)
+DEFINE_SAT_ADD(32, INT32_MIN, INT32_MAX)
+DEFINE_SAT_ADD(64, INT64_MIN, INT64_MAX)
+
+#define DEFINE_FLOYD_WARSHALL(BITS, NEXT_BITS)                                               \
+    static void floydWarshall##BITS##_##NEXT_BITS(const int *mat, int n,                     \
+                                                  int##BITS##_t *d, uint##NEXT_BITS##_t *nx) \
+    {                                                                                        \
+        /* init dp and add the length to next */                                             \
+        for (int i = 0; i < n; ++i)                                                          \
+        {                                                                                    \
+            for (int j = 0; j < n; ++j)                                                      \
+            {                                                                                \
+                size_t ij = (size_t)i * n + j;                                               \
+                if (i == j)                                                                  \
+                {                                                                            \
+                    d[ij] = 0;                                                               \
+                    nx[ij] = NO_NEXT##NEXT_BITS;                                             \
+                    continue;                                                                \
+                }                                                                            \
+                d[ij] = mat[ij];                                                             \
+                /* update next matrix only if there is a path */                             \
+                nx[ij] = mat[ij] != 0 ? (uint##NEXT_BITS##_t)j : NO_NEXT##NEXT_BITS;         \
+            }                                                                                \
+        }                                                                                    \
+                                                                                             \
+        for (int k = 0; k < n; ++k)                                                          \
+        {                                                                                    \
+            const int##BITS##_t *dk = d + (size_t)k * n;                                     \
+            for (int i = 0; i < n; ++i)                                                      \
+            {                                                                                \
+                int##BITS##_t *di = d + (size_t)i * n;                                       \
+                uint##NEXT_BITS##_t *ni = nx + (size_t)i * n;                                \
+                                                                                             \
+                /* there is no path from i to k - nothing goes through k */                  \
+                if (i == k || di[k] == 0)                                                    \
+                    continue;                                                                \
+                                                                                             \
+                for (int j = 0; j < n; ++j)                                                  \
+                {                                                                            \
+                    if (i == j || dk[j] == 0)                                                \
+                        continue;                                                            \
+                                                                                             \
+                    int##BITS##_t through_k = satAdd##BITS(di[k], dk[j]);                    \
+                    if (di[j] == 0 || through_k < di[j])                                     \
+                    {                                                                        \
+                        di[j] = through_k;                                                   \
+                        ni[j] = ni[k];                                                       \
+                    }                                                                        \
+                }                                                                            \
+            }                                                                                \
+        }                                                                                    \
+    }
+
+DEFINE_FLOYD_WARSHALL(16, 16)
+DEFINE_FLOYD_WARSHALL(32, 16)
+DEFINE_FLOYD_WARSHALL(64, 16)
+DEFINE_FLOYD_WARSHALL(16, 32)
+DEFINE_FLOYD_WARSHALL(32, 32)
+DEFINE_FLOYD_WARSHALL(64, 32)
+
+static void floydWarshallGraph(Graph *graph)
+{
+    unmapSnapshot(graph);
+    if (graph->dp == NULL) // Graph_load failed to allocate dp
+        return;
+
+    const int *mat = graph->mat;
+    int n = graph->n;
+    void *d = graph->dp;
+    void *nx = graph->next;
+
+    if (graph->next_bits == 16)
+    {
+        if (graph->dp_bits == 16)
+            floydWarshall16_16(mat, n, d, nx);
+        else if (graph->dp_bits == 32)
+            floydWarshall32_16(mat, n, d, nx);
+        else
+            floydWarshall64_16(mat, n, d, nx);
+    }
+    else
+    {
+        if (graph->dp_bits == 16)
+            floydWarshall16_32(mat, n, d, nx);
+        else if (graph->dp_bits == 32)
+            floydWarshall32_32(mat, n, d, nx);
+        else
+            floydWarshall64_32(mat, n, d, nx);
+    }
+
+    // no need to handle negative cycles
+    graph->dp_ready = TRUE;
+}
+
+void Graph_solve(Graph *graph)
+{
+    // bring dp and next up to date - from the snapshot file if it matches mat,
+    // otherwise with floydWarshall (and save the result for the next run)
+    if (graph->snapshot_path == NULL)
+    {
+        floydWarshallGraph(graph);
+        return;
+    }
+    if (Graph_loadSnapshot(graph, graph->snapshot_path) == TRUE)
+        return;
+
+    floydWarshallGraph(graph);
+    if (Graph_saveSnapshot(graph, graph->snapshot_path) == FALSE)
+        fprintf(stderr, "Warning: can't write snapshot %s\n", graph->snapshot_path);
+}
+
+static long long distance(const Graph *graph, int start, int end)
+{
+    size_t ij = (size_t)start * graph->n + end;
+    if (graph->dp_bits == 16)
+        return ((const int16_t *)graph->dp)[ij];
+    if (graph->dp_bits == 32)
+        return ((const int32_t *)graph->dp)[ij];
+    return ((const int64_t *)graph->dp)[ij];
+}
+
+// reach[dst] |= reach[src] - a whole row of the bitset at once, word by word
+static void orRow(uint64_t *dst, const uint64_t *src, int words)
+{
+    for (int w = 0; w < words; ++w)
+    {
+        dst[w] |= src[w];
+    }
+}
+
+static void transitiveClosureGraph(Graph *graph)
+{
+    int n = graph->n;
+    int words = graph->words;
+
+    // init reach - bit j of row i is set if there is an edge from i to j
+    for (int i = 0; i < n; ++i)
+    {
+        uint64_t *row = graph->reach + (size_t)i * words;
+        const int *edges = graph->mat + (size_t)i * n;
+        memset(row, 0, sizeof(uint64_t) * words);
+        for (int j = 0; j < n; ++j)
         {
-            if (i == j)
-            {
-                dp[i][j] = 0;
-                next[i][j] = -1;
-                continue;
-            }
-            dp[i][j] = mat[i][j];
-            if (mat[i][j] != 0) // Update next matrix only if there is a path
-                next[i][j] = j;
-            else
-                next[i][j] = -1; // No path initially
+            if (i != j && edges[j] != 0)
+                row[j / 64] |= (uint64_t)1 << (j % 64);
         }
     }
+
+    // Warshall - if i reaches k, then i reaches everything k reaches
+    for (int k = 0; k < n; ++k)
+    {
+        const uint64_t *row_k = graph->reach + (size_t)k * words;
+        for (int i = 0; i < n; ++i)
+        {
+            uint64_t *row_i = graph->reach + (size_t)i * words;
+            if (row_i[k / 64] & ((uint64_t)1 << (k % 64)))
+                orRow(row_i, row_k, words);
+        }
+    }
+
+    graph->reach_ready = TRUE;
 }
 
-void floydWarshall(int mat[N][N])
+/*
+ * Iterative Tarjan - finds the strongly connected components without recursion,
+ * so a long path can't overflow the stack.
+ * Components are numbered in the order Tarjan closes them, which is a reverse
+ * topological order: every edge between components goes to a smaller number.
+ * order[] gets the nodes component by component, in that order.
+ */
+static void tarjan(Graph *graph, int *order)
 {
-    setup(mat);
+    int n = graph->n;
+    int *index = graph->scc_work;
+    int *low = index + n;
+    int *stack = low + n;  // nodes of the components that are not closed yet
+    int *call = stack + n; // the nodes of the DFS "recursion"
+    int *pos = call + n;   // the next neighbour each node on call[] looks at
+    int *comp = graph->comp;
+    int counter = 0, stack_top = 0, num_ordered = 0;
 
-    for (int k = 0; k < N; ++k)
+    graph->num_comps = 0;
+    for (int v = 0; v < n; ++v)
     {
-        for (int i = 0; i < N; ++i)
+        index[v] = -1;
+        comp[v] = -1;
+    }
+
+    for (int root = 0; root < n; ++root)
+    {
+        if (index[root] != -1)
+            continue;
+
+        int call_top = 0;
+        call[call_top++] = root;
+        index[root] = low[root] = counter++;
+        pos[root] = 0;
+        stack[stack_top++] = root;
+
+        while (call_top > 0)
         {
-            for (int j = 0; j < N; ++j)
-            {
-                if (i == j)
-                    continue;
+            int v = call[call_top - 1];
+            const int *edges = graph->mat + (size_t)v * n;
 
-                if (dp[i][k] == 0 || dp[k][j] == 0)
+            // look for the next edge of v
+            while (pos[v] < n && (pos[v] == v || edges[pos[v]] == 0))
+                pos[v]++;
+
+            if (pos[v] < n)
+            {
+                int u = pos[v]++;
+                if (index[u] == -1)
                 {
-                    // there is no path from i to k or from k to j
-                    continue;
+                    // "recursive call" on u
+                    index[u] = low[u] = counter++;
+                    pos[u] = 0;
+                    stack[stack_top++] = u;
+                    call[call_top++] = u;
                 }
-
-                // if there is no path from i to j or if the path from i to k and k to j is shorter than the current path
-                if (dp[i][j] == 0 || dp[i][k] + dp[k][j] < dp[i][j])
+                else if (comp[u] == -1 && index[u] < low[v])
                 {
-                    dp[i][j] = dp[i][k] + dp[k][j];
-                    next[i][j] = next[i][k];
+                    // u is still on the stack - part of v's component
+                    low[v] = index[u];
                 }
+                continue;
             }
+
+            // done with v - if it is the root of a component, close the component
+            call_top--;
+            if (low[v] == index[v])
+            {
+                int u;
+                do
+                {
+                    u = stack[--stack_top];
+                    comp[u] = graph->num_comps;
+                    order[num_ordered++] = u;
+                } while (u != v);
+                graph->num_comps++;
+            }
+
+            // "return" to the parent
+            if (call_top > 0)
+            {
+                int parent = call[call_top - 1];
+                if (low[v] < low[parent])
+                    low[parent] = low[v];
+            }
+        }
+    }
+}
+
+/*
+ * Reachability over the condensation - one bitset per component.
+ * The components are closed in reverse topological order, so by the time a
+ * component is handled, everything it has an edge to is complete.
+ */
+static void sccIndexGraph(Graph *graph)
+{
+    int n = graph->n;
+    int *order = graph->scc_work + 5 * n;
+    tarjan(graph, order);
+
+    int words = (graph->num_comps + 63) / 64;
+    graph->comp_words = words;
+
+    int current = -1;
+    uint64_t *row = NULL;
+    for (int i = 0; i < n; ++i)
+    {
+        int v = order[i];
+        int c = graph->comp[v];
+        if (c != current)
+        {
+            // first node of a new component - it reaches itself
+            current = c;
+            row = graph->reach + (size_t)c * words;
+            memset(row, 0, sizeof(uint64_t) * words);
+            row[c / 64] |= (uint64_t)1 << (c % 64);
+        }
+
+        const int *edges = graph->mat + (size_t)v * n;
+        for (int u = 0; u < n; ++u)
+        {
+            if (u == v || edges[u] == 0)
+                continue;
+
+            // if d is already in the row, so is everything d reaches
+            int d = graph->comp[u];
+            if (!(row[d / 64] & ((uint64_t)1 << (d % 64))))
+                orRow(row, graph->reach + (size_t)d * words, words);
         }
     }
 
-    // no need to handle negative cycles
-    //    return dp;
+    graph->reach_ready = TRUE;
+}
+
+void Graph_setReachEngine(Graph *graph, int engine)
+{
+    if (engine != graph->reach_engine)
+    {
+        graph->reach_engine = engine;
+        graph->reach_ready = FALSE;
+    }
+}
+
+void Graph_solveReach(Graph *graph)
+{
+    if (graph->reach_engine == REACH_SCC)
+        sccIndexGraph(graph);
+    else
+        transitiveClosureGraph(graph);
+}
+
+int Graph_isPathExists(Graph *graph, int start, int end)
+{
+    // a node has no path to itself (dp[i][i] is always 0)
+    if (start == end)
+        return FALSE;
+
+    // if a shortest path query already paid for the distances (or a snapshot has them) - use them,
+    // otherwise the bitset closure is enough to know if there is a path
+    if (graph->dp_ready == FALSE && graph->snapshot_path != NULL)
+        Graph_solve(graph);
+
+    if (graph->dp_ready == TRUE)
+        return distance(graph, start, end) != 0 ? TRUE : FALSE;
+
+    if (graph->reach_ready == FALSE)
+        Graph_solveReach(graph);
+
+    if (graph->reach_engine == REACH_SCC)
+    {
+        // two component lookups and one bit
+        int from = graph->comp[start];
+        int to = graph->comp[end];
+        const uint64_t *row = graph->reach + (size_t)from * graph->comp_words;
+        return (row[to / 64] >> (to % 64)) & 1 ? TRUE : FALSE;
+    }
+
+    const uint64_t *row = graph->reach + (size_t)start * graph->words;
+    return (row[end / 64] >> (end % 64)) & 1 ? TRUE : FALSE;
+}
+
+long long Graph_shortestPath(Graph *graph, int start, int end)
+{
+    if (graph->dp_ready == FALSE)
+        Graph_solve(graph);
+
+    // not path
+    if (graph->dp_ready == FALSE || start == end || distance(graph, start, end) == 0)
+        return -1;
+
+    return distance(graph, start, end);
+}
+
+int Graph_nextHop(Graph *graph, int start, int end)
+{
+    if (graph->dp_ready == FALSE)
+        Graph_solve(graph);
+    if (graph->dp_ready == FALSE || start == end)
+        return -1;
+
+    size_t ij = (size_t)start * graph->n + end;
+    if (graph->next_bits == 16)
+    {
+        uint16_t hop = ((const uint16_t *)graph->next)[ij];
+        return hop == NO_NEXT16 ? -1 : hop;
+    }
+    uint32_t hop = ((const uint32_t *)graph->next)[ij];
+    return hop == NO_NEXT32 ? -1 : (int)hop;
+}
+
+// the graphs Graph_solveAll hands out to its workers, one index at a time
+typedef struct
+{
+    Graph **graphs;
+    int count;
+    atomic_int next_index;
+} GraphBatch;
+
+static void *solveWorker(void *arg)
+{
+    GraphBatch *batch = arg;
+    int i;
+    while ((i = atomic_fetch_add(&batch->next_index, 1)) < batch->count)
+    {
+        Graph_solve(batch->graphs[i]);
+    }
+    return NULL;
+}
+
+void Graph_solveAll(Graph *graphs[], int count, int num_threads)
+{
+    GraphBatch batch;
+    batch.graphs = graphs;
+    batch.count = count;
+    atomic_init(&batch.next_index, 0);
+
+    if (num_threads > count)
+        num_threads = count;
+
+    // the calling thread is one of the workers
+    pthread_t threads[num_threads > 1 ? num_threads - 1 : 1];
+    int started = 0;
+    for (; started < num_threads - 1; started++)
+    {
+        if (pthread_create(&threads[started], NULL, solveWorker, &batch) != 0)
+            break;
+    }
+    solveWorker(&batch);
+
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+//------------------------------------------------
+// APSP snapshot
+//------------------------------------------------
+
+/*
+ * Snapshot file layout - every part starts on a page boundary:
+ *   page 0        - SnapshotHeader
+ *   mat_offset    - the input matrix the snapshot was computed from
+ *   dp_offset     - dp, n * n cells of dp_bits bits
+ *   next_offset   - next, n * n cells of next_bits bits
+ */
+#define SNAPSHOT_MAGIC "APSPSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 4096
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t n;
+    uint32_t dp_bits;
+    uint32_t next_bits;
+    uint64_t hash;
+    uint64_t mat_offset;
+    uint64_t dp_offset;
+    uint64_t next_offset;
+    uint64_t file_size;
+} SnapshotHeader;
+
+static uint64_t alignUp(uint64_t x)
+{
+    return (x + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+// FNV-1a over the bytes of the matrix
+static uint64_t hashMatrix(const int *mat, int n)
+{
+    const unsigned char *p = (const unsigned char *)mat;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(int) * n * n; ++i)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// fill the header for a dp of the given width, the offsets are page aligned
+static void makeHeader(const Graph *graph, SnapshotHeader *header, uint64_t hash, int bits)
+{
+    uint64_t cells = (uint64_t)graph->n * graph->n;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    header->n = graph->n;
+    header->dp_bits = bits;
+    header->next_bits = graph->next_bits;
+    header->hash = hash;
+    header->mat_offset = SNAPSHOT_ALIGN;
+    header->dp_offset = alignUp(header->mat_offset + sizeof(int) * cells);
+    header->next_offset = alignUp(header->dp_offset + (uint64_t)bits / 8 * cells);
+    header->file_size = alignUp(header->next_offset + (uint64_t)graph->next_bits / 8 * cells);
+}
+
+static int writeAt(int fd, const void *buf, size_t size, uint64_t offset)
+{
+    const char *p = buf;
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, p, size, offset);
+        if (written <= 0)
+            return FALSE;
+        p += written;
+        size -= written;
+        offset += written;
+    }
+    return TRUE;
+}
+
+int Graph_saveSnapshot(Graph *graph, const char *path)
+{
+    if (graph->dp_ready == FALSE)
+        return FALSE;
+
+    size_t cells = (size_t)graph->n * graph->n;
+    SnapshotHeader header;
+    makeHeader(graph, &header, hashMatrix(graph->mat, graph->n), graph->dp_bits);
+
+    // write to a temp file and rename it, so a reader never maps a half written snapshot
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path))
+        return FALSE;
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return FALSE;
+
+    int ok = ftruncate(fd, header.file_size) == 0 &&
+             writeAt(fd, &header, sizeof(header), 0) &&
+             writeAt(fd, graph->mat, sizeof(int) * cells, header.mat_offset) &&
+             writeAt(fd, graph->dp, (size_t)graph->dp_bits / 8 * cells, header.dp_offset) &&
+             writeAt(fd, graph->next, (size_t)graph->next_bits / 8 * cells, header.next_offset);
+
+    if (close(fd) != 0 || !ok || rename(tmp_path, path) != 0)
+    {
+        unlink(tmp_path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int Graph_loadSnapshot(Graph *graph, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return FALSE;
+
+    struct stat st;
+    SnapshotHeader header;
+    if (fstat(fd, &st) != 0 || st.st_size < SNAPSHOT_ALIGN ||
+        pread(fd, &header, sizeof(header), 0) != sizeof(header))
+    {
+        close(fd);
+        return FALSE;
+    }
+
+    // the snapshot must be of this version and layout, and computed from this matrix
+    SnapshotHeader expected;
+    int bits = header.dp_bits == 16 || header.dp_bits == 64 ? header.dp_bits : 32;
+    makeHeader(graph, &expected, hashMatrix(graph->mat, graph->n), bits);
+    if (memcmp(&header, &expected, sizeof(header)) != 0 || (uint64_t)st.st_size < header.file_size)
+    {
+        close(fd);
+        return FALSE;
+    }
+
+    void *map = mmap(NULL, header.file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid after close
+    if (map == MAP_FAILED)
+        return FALSE;
+
+    // a hash can collide - compare the stored matrix too, it's only n*n of the n^3 we skip
+    if (memcmp((char *)map + header.mat_offset, graph->mat, sizeof(int) * graph->n * graph->n) != 0)
+    {
+        munmap(map, header.file_size);
+        return FALSE;
+    }
+
+    unmapSnapshot(graph);
+    graph->snapshot_map = map;
+    graph->snapshot_size = header.file_size;
+    graph->dp_bits = bits;
+    graph->dp = (char *)map + header.dp_offset;
+    graph->next = (char *)map + header.next_offset;
+    graph->dp_ready = TRUE;
+    return TRUE;
+}
+
+void Graph_setSnapshotPath(Graph *graph, const char *path)
+{
+    graph->snapshot_path = path;
+}
+
+//------------------------------------------------
+// N x N API - one shared graph, kept for my_graph's original interface
+//------------------------------------------------
+
+Graph *default_graph = NULL;
+
+static Graph *defaultGraph()
+{
+    if (default_graph == NULL)
+        default_graph = Graph_alloc(N, NULL);
+    return default_graph;
+}
+
+void floydWarshall(int mat[N][N])
+{
+    Graph_load(defaultGraph(), &mat[0][0]);
+    Graph_solve(default_graph);
+}
+
+long long getDistance(int start, int end)
+{
+    return distance(defaultGraph(), start, end);
+}
+
+void transitiveClosure(int mat[N][N])
+{
+    Graph_load(defaultGraph(), &mat[0][0]);
+    Graph_solveReach(default_graph);
+}
+
+int isReachable(int mat[N][N], int start, int end, int need_update)
+{
+    if (need_update == TRUE)
+    {
+        transitiveClosure(mat);
+    }
+    return Graph_isPathExists(defaultGraph(), start, end);
 }
 
 int isPathExists(int mat[N][N], int start, int end, int need_update)
@@ -67,7 +887,7 @@ int isPathExists(int mat[N][N], int start, int end, int need_update)
     {
         floydWarshall(mat);
     }
-    return dp[start][end] != 0 ? TRUE : FALSE;
+    return Graph_isPathExists(defaultGraph(), start, end);
 }
 
 void printShortestPath(int mat[N][N], int start, int end, int need_update)
@@ -77,14 +897,16 @@ void printShortestPath(int mat[N][N], int start, int end, int need_update)
         floydWarshall(mat);
     }
 
+    long long length = Graph_shortestPath(defaultGraph(), start, end);
+
     // not path
-    if (isPathExists(mat, start, end, FALSE) == FALSE || (start == end && mat[start][end] == 0))
+    if (length == -1)
     {
         puts("-1");
         return;
     }
 
-    printf("%d\n", dp[start][end]);
+    printf("%lld\n", length);
 
     // int at = start;
     // printf("%d", at); // print the start node
@@ -96,4 +918,22 @@ void printShortestPath(int mat[N][N], int start, int end, int need_update)
     // }
 
     // printf("\n");
-}
\ No newline at end of file
+}
+
+void setSnapshotPath(const char *path)
+{
+    Graph_setSnapshotPath(defaultGraph(), path);
+}
+
+int saveSnapshot(const char *path, int mat[N][N])
+{
+    Graph_load(defaultGraph(), &mat[0][0]);
+    Graph_solve(default_graph);
+    return Graph_saveSnapshot(default_graph, path);
+}
+
+int loadSnapshot(const char *path, int mat[N][N])
+{
+    Graph_load(defaultGraph(), &mat[0][0]);
+    return Graph_loadSnapshot(default_graph, path);
+}
@@ -1,8 +1,171 @@
+#include <stddef.h>
+
 #define N 10
 
 #define TRUE 1
 #define FALSE 0
 
-void floydWarshall();
+void floydWarshall(int mat[N][N]);
+long long getDistance(int start, int end);
+void transitiveClosure(int mat[N][N]);
+int isReachable(int mat[N][N], int start, int end, int need_update);
 int isPathExists(int mat[N][N], int start, int end, int need_update);
 void printShortestPath(int mat[N][N], int start, int end, int need_update);
+
+// keep floydWarshall results in a snapshot file, NULL to stop using one
+void setSnapshotPath(const char *path);
+int saveSnapshot(const char *path, int mat[N][N]);
+int loadSnapshot(const char *path, int mat[N][N]);
+
+/*
+ * Graph - a reentrant graph context of n nodes.
+ * Every Graph owns its matrices, so different graphs can be loaded and solved
+ * at the same time from different threads. The N x N functions above all use
+ * one shared Graph.
+ */
+struct _Graph;
+typedef struct _Graph Graph;
+
+/*
+ * Where a Graph gets its memory from - alloc and free get ctx as their first argument.
+ */
+typedef struct
+{
+    void *(*alloc)(void *ctx, size_t size);
+    void (*free)(void *ctx, void *ptr);
+    void *ctx;
+} GraphAllocator;
+
+/*
+ * A bump allocator over a caller supplied buffer.
+ * Graph_free gives nothing back to it, GraphArena_reset releases everything at once.
+ */
+typedef struct
+{
+    char *base;
+    size_t size;
+    size_t used;
+} GraphArena;
+
+void GraphArena_init(GraphArena *arena, void *buffer, size_t size);
+void GraphArena_reset(GraphArena *arena);
+GraphAllocator GraphArena_allocator(GraphArena *arena);
+
+/*
+ * Allocates a graph of n nodes, with malloc if allocator is NULL.
+ * Returns NULL if there is not enough memory.
+ */
+Graph *Graph_alloc(int n, const GraphAllocator *allocator);
+void Graph_free(Graph *graph);
+int Graph_size(const Graph *graph);
+
+/*
+ * Copies the n * n adjacency matrix (row by row, 0 for no edge) into the graph.
+ * Returns FALSE if there is not enough memory for the distances.
+ */
+int Graph_load(Graph *graph, const int *mat);
+
+/*
+ * Computes all the shortest paths (or maps them from the snapshot file).
+ * The queries call it when needed, call it directly to solve ahead of time.
+ */
+void Graph_solve(Graph *graph);
+
+/*
+ * Solves every graph, on num_threads threads. The graphs must be different
+ * objects and must not share a snapshot file.
+ */
+void Graph_solveAll(Graph *graphs[], int count, int num_threads);
+
+/*
+ * Computes only which nodes can reach which, with the engine set by
+ * Graph_setReachEngine. Graph_isPathExists uses it when the distances are not up to date.
+ *   REACH_CLOSURE - bitset Warshall over the nodes, n^3 / 64
+ *   REACH_SCC     - strongly connected components, then bitsets over the
+ *                   components only (the default)
+ */
+#define REACH_CLOSURE 0
+#define REACH_SCC 1
+
+void Graph_setReachEngine(Graph *graph, int engine);
+void Graph_solveReach(Graph *graph);
+
+int Graph_isPathExists(Graph *graph, int start, int end);
+
+/*
+ * Returns the length of the shortest path from start to end, -1 if there is none.
+ */
+long long Graph_shortestPath(Graph *graph, int start, int end);
+
+/*
+ * Returns the node after start on the shortest path from start to end, -1 if there is none.
+ * Following it from start until end gives the whole path.
+ */
+int Graph_nextHop(Graph *graph, int start, int end);
+
+void Graph_setSnapshotPath(Graph *graph, const char *path);
+int Graph_saveSnapshot(Graph *graph, const char *path);
+int Graph_loadSnapshot(Graph *graph, const char *path);
+
+/*
+ * TiledGraph - shortest paths for graphs whose n * n distances don't fit in memory.
+ * The distances live in a file of tile x tile blocks, and a blocked Floyd-Warshall
+ * keeps only the few tiles the current step needs in memory, reading the next
+ * ones on another thread. The distances are the same as Graph_shortestPath's.
+ * The edges are kept in the file too, apart from the distances, so the file is
+ * twice the n * n distances.
+ */
+struct _TiledGraph;
+typedef struct _TiledGraph TiledGraph;
+
+/*
+ * Creates (or overwrites) the tile file at path for a graph of n nodes without edges.
+ * Returns NULL if the file or the tile buffers can't be made.
+ */
+TiledGraph *TiledGraph_alloc(const char *path, int n, int tile);
+void TiledGraph_free(TiledGraph *graph);
+
+/*
+ * Sets the edges out of node i - row[j] is the weight of i -> j, 0 for no edge.
+ * The other rows keep their edges, also after a solve - the next solve starts
+ * again from the edges of all the rows.
+ */
+int TiledGraph_setRow(TiledGraph *graph, int i, const int *row);
+int TiledGraph_solve(TiledGraph *graph);
+
+// the queries solve the graph first if any row changed since the last solve
+long long TiledGraph_shortestPath(TiledGraph *graph, int start, int end);
+int TiledGraph_isPathExists(TiledGraph *graph, int start, int end);
+
+/*
+ * DistanceOracle - Thorup-Zwick approximate distances, for graphs too big for
+ * n * n memory. With k levels it takes O(k n^(1 + 1/k)) space on average and a
+ * query takes O(k) steps. The oracle is for undirected graphs - an edge in
+ * either direction is used both ways - and the answer is at least the
+ * undirected distance and at most 2k - 1 times it. On a directed graph it can
+ * be below the real distance, or find a path where there is none.
+ */
+struct _DistanceOracle;
+typedef struct _DistanceOracle DistanceOracle;
+
+// an edge from -> to, weight > 0
+typedef struct
+{
+    int from;
+    int to;
+    int weight;
+} GraphEdge;
+
+/*
+ * Builds the oracle of n nodes - seed picks the random levels.
+ * Returns NULL if there is not enough memory.
+ */
+DistanceOracle *DistanceOracle_alloc(int n, int num_edges, const GraphEdge *edges, int k, unsigned int seed);
+void DistanceOracle_free(DistanceOracle *oracle);
+
+/*
+ * Returns the approximate distance between start and end, -1 if they are not connected.
+ */
+long long DistanceOracle_query(const DistanceOracle *oracle, int start, int end);
+int DistanceOracle_stretch(const DistanceOracle *oracle);
+size_t DistanceOracle_bunchSize(const DistanceOracle *oracle);
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include "my_knap_engine.h"
+
+// the sum of a subset of one half of the items - bit k of mask is item k of the half
+typedef struct
+{
+    long long weight;
+    long long value;
+    uint32_t mask;
+} MitmSum;
+
+/**
+ * All the subset sums of a half of the items that are worth keeping - sorted by
+ * weight with the value going strictly up, so a heavier sum that isn't worth
+ * more is dropped. Adding an item merges the list with itself shifted by the
+ * item, both sorted already, so there is no sort at all.
+ * @param list room for 2^count sums, the result is in list or tmp
+ * @param tmp room for 2^count sums
+ * @return the number of sums, *result is the one of list / tmp they are in
+ */
+static int subsetSums(const long long weights[], const long long values[], int count, long long capacity,
+                      MitmSum *list, MitmSum *tmp, MitmSum **result)
+{
+    int size = 1;
+    list[0].weight = 0;
+    list[0].value = 0;
+    list[0].mask = 0;
+
+    for (int k = 0; k < count; k++)
+    {
+        int i = 0;
+        int j = 0;
+        int merged = 0;
+        while (i < size || j < size)
+        {
+            // the sums of list with item k, as long as they fit
+            int with_item = j < size && list[j].weight <= capacity - weights[k];
+            MitmSum next;
+            if (with_item && (i >= size || list[j].weight + weights[k] < list[i].weight))
+            {
+                next.weight = list[j].weight + weights[k];
+                next.value = list[j].value + values[k];
+                next.mask = list[j].mask | (uint32_t)1 << k;
+                j++;
+            }
+            else if (i < size)
+            {
+                next = list[i++];
+            }
+            else
+            {
+                break;
+            }
+
+            // keep only the sums worth more than every lighter one
+            if (merged > 0 && next.value <= tmp[merged - 1].value)
+                continue;
+            if (merged > 0 && next.weight == tmp[merged - 1].weight)
+                merged--;
+            tmp[merged++] = next;
+        }
+
+        MitmSum *swap = list;
+        list = tmp;
+        tmp = swap;
+        size = merged;
+    }
+
+    *result = list;
+    return size;
+}
+
+/*
+ * Meet in the middle (Horowitz - Sahni) - the subset sums of each half of the
+ * items, and for every sum of the first half, from light to heavy, the heaviest
+ * sum of the second half that still fits - it is the best one, since the values
+ * go up with the weights. 2^(n/2) sums in each half instead of 2^n subsets.
+ */
+int knapSolveMitm(Knapsack *knap, int n, const long long weights[], const long long values[],
+                  long long capacity, int selected[])
+{
+    // the items that weigh nothing are always taken, the ones worth nothing or
+    // heavier than the knapsack never
+    int index[MITM_MAX_ITEMS];
+    long long item_weights[MITM_MAX_ITEMS];
+    long long item_values[MITM_MAX_ITEMS];
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (values[i] == 0 || weights[i] > capacity)
+            continue;
+        if (weights[i] == 0)
+        {
+            selected[i] = TRUE;
+            continue;
+        }
+        if (count == MITM_MAX_ITEMS)
+            return FALSE;
+        index[count] = i;
+        item_weights[count] = weights[i];
+        item_values[count] = values[i];
+        count++;
+    }
+
+    int half = count / 2;
+    size_t first_size = sizeof(MitmSum) * ((size_t)1 << half);
+    size_t second_size = sizeof(MitmSum) * ((size_t)1 << (count - half));
+    MitmSum *first[2] = {knapTake(knap, first_size), knapTake(knap, first_size)};
+    MitmSum *second[2] = {knapTake(knap, second_size), knapTake(knap, second_size)};
+    if (first[0] == NULL || first[1] == NULL || second[0] == NULL || second[1] == NULL)
+        return FALSE;
+
+    MitmSum *a, *b;
+    int a_size = subsetSums(item_weights, item_values, half, capacity, first[0], first[1], &a);
+    int b_size = subsetSums(item_weights + half, item_values + half, count - half, capacity,
+                            second[0], second[1], &b);
+
+    // the sums of the first half get heavier, so the one of the second half only goes back
+    long long best = -1;
+    uint32_t best_a = 0;
+    uint32_t best_b = 0;
+    int j = b_size - 1;
+    for (int i = 0; i < a_size && j >= 0; i++)
+    {
+        while (j >= 0 && b[j].weight > capacity - a[i].weight)
+        {
+            j--;
+        }
+        if (j >= 0 && a[i].value + b[j].value > best)
+        {
+            best = a[i].value + b[j].value;
+            best_a = a[i].mask;
+            best_b = b[j].mask;
+        }
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        uint32_t bit = k < half ? best_a >> k & 1 : best_b >> (k - half) & 1;
+        if (bit == 1)
+            selected[index[k]] = TRUE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "my_mat.h"
+
+/*
+ * Thorup-Zwick approximate distance oracle.
+ *
+ * Levels A_0 = V, A_1, ..., A_{k-1}, every level a random sample of the one
+ * below with probability n^(-1/k), and A_k empty. For every node v:
+ *   p_i(v) - the nearest node of A_i, at distance d_i(v)
+ *   B(v)   - its bunch, every w of A_i \ A_{i+1} closer to v than A_{i+1} is,
+ *            with the exact distance from w
+ * A query walks up the levels, at most k steps, until the pivot is in the
+ * other node's bunch. The answer is at most (2k - 1) times the real distance,
+ * and the bunches take O(k n^(1 + 1/k)) space on average.
+ *
+ * The oracle is for undirected graphs - an edge in either direction is used
+ * both ways, with the lighter weight.
+ */
+
+#define INF INT64_MAX
+
+// one entry of a bunch - a node w of the bunch and its distance
+typedef struct
+{
+    int node;
+    int64_t dist;
+} BunchEntry;
+
+struct _DistanceOracle
+{
+    int n;
+    int k;
+
+    // adjacency lists (both directions), CSR
+    int *adj_start;
+    int *adj_node;
+    int *adj_weight;
+
+    // pivot[i * n + v] = p_i(v), -1 if no node of A_i is connected to v
+    int *pivot;
+    int64_t *pivot_dist;
+
+    // bunch of v - an open addressing table of bunch_size[v] slots (a power of 2)
+    // at bunch[bunch_start[v]], node -1 for an empty slot
+    size_t *bunch_start;
+    int *bunch_size;
+    BunchEntry *bunch;
+    size_t bunch_entries;
+};
+
+//------------------------------------------------
+// Binary heap of (dist, node) for Dijkstra, with lazy deletion
+//------------------------------------------------
+
+typedef struct
+{
+    int64_t dist;
+    int node;
+} HeapItem;
+
+typedef struct
+{
+    HeapItem *items;
+    size_t size;
+    size_t capacity;
+} Heap;
+
+static int heapPush(Heap *heap, int64_t dist, int node)
+{
+    if (heap->size == heap->capacity)
+    {
+        size_t capacity = heap->capacity == 0 ? 64 : heap->capacity * 2;
+        HeapItem *items = realloc(heap->items, sizeof(HeapItem) * capacity);
+        if (items == NULL)
+            return FALSE;
+        heap->items = items;
+        heap->capacity = capacity;
+    }
+
+    size_t i = heap->size++;
+    while (i > 0 && heap->items[(i - 1) / 2].dist > dist)
+    {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i].dist = dist;
+    heap->items[i].node = node;
+    return TRUE;
+}
+
+static HeapItem heapPop(Heap *heap)
+{
+    HeapItem top = heap->items[0];
+    HeapItem last = heap->items[--heap->size];
+
+    size_t i = 0;
+    while (2 * i + 1 < heap->size)
+    {
+        size_t child = 2 * i + 1;
+        if (child + 1 < heap->size && heap->items[child + 1].dist < heap->items[child].dist)
+            child++;
+        if (heap->items[child].dist >= last.dist)
+            break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->size > 0)
+        heap->items[i] = last;
+    return top;
+}
+
+//------------------------------------------------
+// Building
+//------------------------------------------------
+
+static uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static int buildAdjacency(DistanceOracle *oracle, int num_edges, const GraphEdge *edges)
+{
+    int n = oracle->n;
+    oracle->adj_start = calloc(n + 1, sizeof(int));
+    oracle->adj_node = malloc(sizeof(int) * 2 * (num_edges + 1));
+    oracle->adj_weight = malloc(sizeof(int) * 2 * (num_edges + 1));
+    if (oracle->adj_start == NULL || oracle->adj_node == NULL || oracle->adj_weight == NULL)
+        return FALSE;
+
+    // count, prefix sum, then fill - every edge goes in both directions
+    for (int e = 0; e < num_edges; e++)
+    {
+        oracle->adj_start[edges[e].from + 1]++;
+        oracle->adj_start[edges[e].to + 1]++;
+    }
+    for (int v = 0; v < n; v++)
+    {
+        oracle->adj_start[v + 1] += oracle->adj_start[v];
+    }
+
+    int *fill = malloc(sizeof(int) * n);
+    if (fill == NULL)
+        return FALSE;
+    memcpy(fill, oracle->adj_start, sizeof(int) * n);
+    for (int e = 0; e < num_edges; e++)
+    {
+        int a = edges[e].from, b = edges[e].to;
+        oracle->adj_node[fill[a]] = b;
+        oracle->adj_weight[fill[a]++] = edges[e].weight;
+        oracle->adj_node[fill[b]] = a;
+        oracle->adj_weight[fill[b]++] = edges[e].weight;
+    }
+    free(fill);
+    return TRUE;
+}
+
+/*
+ * Dijkstra from every node of level (all sources at distance 0) -
+ * fills p_level(v) and d_level(v) for every v.
+ */
+static int nearestOfLevel(DistanceOracle *oracle, const int *level, int i, Heap *heap)
+{
+    int n = oracle->n;
+    int *pivot = oracle->pivot + (size_t)i * n;
+    int64_t *dist = oracle->pivot_dist + (size_t)i * n;
+
+    heap->size = 0;
+    for (int v = 0; v < n; v++)
+    {
+        pivot[v] = -1;
+        dist[v] = INF;
+        if (level[v] >= i)
+        {
+            pivot[v] = v;
+            dist[v] = 0;
+            if (!heapPush(heap, 0, v))
+                return FALSE;
+        }
+    }
+
+    while (heap->size > 0)
+    {
+        HeapItem item = heapPop(heap);
+        int v = item.node;
+        if (item.dist != dist[v])
+            continue;
+
+        for (int e = oracle->adj_start[v]; e < oracle->adj_start[v + 1]; e++)
+        {
+            int u = oracle->adj_node[e];
+            int64_t through_v = item.dist + oracle->adj_weight[e];
+            if (through_v < dist[u])
+            {
+                dist[u] = through_v;
+                pivot[u] = pivot[v];
+                if (!heapPush(heap, through_v, u))
+                    return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+// a node v joined the cluster of w, at distance dist
+typedef struct
+{
+    int node;
+    int center;
+    int64_t dist;
+} ClusterItem;
+
+typedef struct
+{
+    ClusterItem *items;
+    size_t size;
+    size_t capacity;
+} ClusterList;
+
+static int clusterAdd(ClusterList *list, int node, int center, int64_t dist)
+{
+    if (list->size == list->capacity)
+    {
+        size_t capacity = list->capacity == 0 ? 1024 : list->capacity * 2;
+        ClusterItem *items = realloc(list->items, sizeof(ClusterItem) * capacity);
+        if (items == NULL)
+            return FALSE;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->size].node = node;
+    list->items[list->size].center = center;
+    list->items[list->size].dist = dist;
+    list->size++;
+    return TRUE;
+}
+
+/*
+ * The cluster of w (a node of A_i \ A_{i+1}) - every v with d(w, v) < d_{i+1}(v).
+ * A Dijkstra from w that only keeps a node when it beats the next level, which
+ * is enough because clusters are closed under shortest paths to w.
+ * dist[] is all INF on entry and is left that way, touched[] remembers what to reset.
+ */
+static int growCluster(DistanceOracle *oracle, int w, int i, int64_t *dist, int *touched,
+                       Heap *heap, ClusterList *clusters)
+{
+    int n = oracle->n;
+    const int64_t *next_level = i + 1 < oracle->k ? oracle->pivot_dist + (size_t)(i + 1) * n : NULL;
+    int num_touched = 0;
+    int ok = TRUE;
+
+    heap->size = 0;
+    dist[w] = 0;
+    touched[num_touched++] = w;
+    ok = heapPush(heap, 0, w);
+
+    while (ok && heap->size > 0)
+    {
+        HeapItem item = heapPop(heap);
+        int v = item.node;
+        if (item.dist != dist[v])
+            continue;
+
+        ok = clusterAdd(clusters, v, w, item.dist);
+        for (int e = oracle->adj_start[v]; ok && e < oracle->adj_start[v + 1]; e++)
+        {
+            int u = oracle->adj_node[e];
+            int64_t through_v = item.dist + oracle->adj_weight[e];
+            int64_t limit = next_level == NULL ? INF : next_level[u];
+            if (through_v < dist[u] && through_v < limit)
+            {
+                if (dist[u] == INF)
+                    touched[num_touched++] = u;
+                dist[u] = through_v;
+                ok = heapPush(heap, through_v, u);
+            }
+        }
+    }
+
+    for (int t = 0; t < num_touched; t++)
+    {
+        dist[touched[t]] = INF;
+    }
+    return ok;
+}
+
+static size_t bunchHash(int node, int size)
+{
+    return ((uint32_t)node * 2654435761u) & (uint32_t)(size - 1);
+}
+
+// turns the cluster list into the bunch tables - v's bunch is every cluster v is in
+static int buildBunches(DistanceOracle *oracle, const ClusterList *clusters)
+{
+    int n = oracle->n;
+    oracle->bunch_start = malloc(sizeof(size_t) * (n + 1));
+    oracle->bunch_size = calloc(n, sizeof(int));
+    if (oracle->bunch_start == NULL || oracle->bunch_size == NULL)
+        return FALSE;
+
+    // count, then round every table up to a power of 2 at most half full
+    for (size_t c = 0; c < clusters->size; c++)
+    {
+        oracle->bunch_size[clusters->items[c].node]++;
+    }
+    size_t total = 0;
+    for (int v = 0; v < n; v++)
+    {
+        int size = 1;
+        while (size < 2 * oracle->bunch_size[v])
+            size *= 2;
+        oracle->bunch_size[v] = size;
+        oracle->bunch_start[v] = total;
+        total += size;
+    }
+    oracle->bunch_start[n] = total;
+    oracle->bunch_entries = clusters->size;
+
+    oracle->bunch = malloc(sizeof(BunchEntry) * total);
+    if (oracle->bunch == NULL)
+        return FALSE;
+    for (size_t b = 0; b < total; b++)
+    {
+        oracle->bunch[b].node = -1;
+    }
+
+    for (size_t c = 0; c < clusters->size; c++)
+    {
+        const ClusterItem *item = &clusters->items[c];
+        BunchEntry *table = oracle->bunch + oracle->bunch_start[item->node];
+        int size = oracle->bunch_size[item->node];
+        size_t slot = bunchHash(item->center, size);
+        while (table[slot].node != -1)
+            slot = (slot + 1) & (size - 1);
+        table[slot].node = item->center;
+        table[slot].dist = item->dist;
+    }
+    return TRUE;
+}
+
+// d(w, v) if w is in v's bunch, -1 if not
+static int64_t bunchFind(const DistanceOracle *oracle, int v, int w)
+{
+    const BunchEntry *table = oracle->bunch + oracle->bunch_start[v];
+    int size = oracle->bunch_size[v];
+    size_t slot = bunchHash(w, size);
+    while (table[slot].node != -1)
+    {
+        if (table[slot].node == w)
+            return table[slot].dist;
+        slot = (slot + 1) & (size - 1);
+    }
+    return -1;
+}
+
+DistanceOracle *DistanceOracle_alloc(int n, int num_edges, const GraphEdge *edges, int k, unsigned int seed)
+{
+    if (n <= 0 || k < 1 || num_edges < 0)
+        return NULL;
+
+    DistanceOracle *oracle = calloc(1, sizeof(DistanceOracle));
+    if (oracle == NULL)
+        return NULL;
+    oracle->n = n;
+    oracle->k = k;
+
+    int *level = malloc(sizeof(int) * n);
+    int64_t *dist = malloc(sizeof(int64_t) * n);
+    int *touched = malloc(sizeof(int) * n);
+    oracle->pivot = malloc(sizeof(int) * n * k);
+    oracle->pivot_dist = malloc(sizeof(int64_t) * n * k);
+    Heap heap = {NULL, 0, 0};
+    ClusterList clusters = {NULL, 0, 0};
+    int ok = level != NULL && dist != NULL && touched != NULL &&
+             oracle->pivot != NULL && oracle->pivot_dist != NULL &&
+             buildAdjacency(oracle, num_edges, edges);
+
+    if (ok)
+    {
+        // level[v] = the highest i with v in A_i. A_{k-1} must not be empty,
+        // so sample again until it isn't
+        uint64_t state = seed * 2654435761ULL + 88172645463325252ULL;
+        double keep = pow(n, -1.0 / k);
+        int top_count;
+        do
+        {
+            top_count = 0;
+            for (int v = 0; v < n; v++)
+            {
+                level[v] = 0;
+                while (level[v] < k - 1 && (nextRandom(&state) >> 11) * (1.0 / 9007199254740992.0) < keep)
+                    level[v]++;
+                top_count += level[v] == k - 1;
+            }
+        } while (top_count == 0);
+
+        for (int i = 0; ok && i < k; i++)
+        {
+            ok = nearestOfLevel(oracle, level, i, &heap);
+        }
+
+        for (int v = 0; v < n; v++)
+        {
+            dist[v] = INF;
+        }
+        // clusters of every node w of A_i \ A_{i+1}, that is level[w] == i
+        for (int w = 0; ok && w < n; w++)
+        {
+            ok = growCluster(oracle, w, level[w], dist, touched, &heap, &clusters);
+        }
+        ok = ok && buildBunches(oracle, &clusters);
+    }
+
+    free(level);
+    free(dist);
+    free(touched);
+    free(heap.items);
+    free(clusters.items);
+    if (!ok)
+    {
+        DistanceOracle_free(oracle);
+        return NULL;
+    }
+    return oracle;
+}
+
+void DistanceOracle_free(DistanceOracle *oracle)
+{
+    if (oracle == NULL)
+        return;
+    free(oracle->adj_start);
+    free(oracle->adj_node);
+    free(oracle->adj_weight);
+    free(oracle->pivot);
+    free(oracle->pivot_dist);
+    free(oracle->bunch_start);
+    free(oracle->bunch_size);
+    free(oracle->bunch);
+    free(oracle);
+}
+
+long long DistanceOracle_query(const DistanceOracle *oracle, int start, int end)
+{
+    // a node has no path to itself, like Graph_shortestPath
+    if (start == end)
+        return -1;
+
+    int n = oracle->n;
+    int u = start, v = end;
+    int w = u;
+    int64_t w_to_u = 0;
+
+    for (int i = 0; i < oracle->k; i++)
+    {
+        if (i > 0)
+        {
+            // go up one level, from the other side
+            int swap = u;
+            u = v;
+            v = swap;
+            w = oracle->pivot[(size_t)i * n + u];
+            w_to_u = oracle->pivot_dist[(size_t)i * n + u];
+            if (w == -1) // nothing of A_i is connected to u
+                return -1;
+        }
+
+        int64_t w_to_v = bunchFind(oracle, v, w);
+        if (w_to_v != -1)
+            return w_to_u + w_to_v;
+    }
+
+    // start and end are not connected
+    return -1;
+}
+
+int DistanceOracle_stretch(const DistanceOracle *oracle)
+{
+    return 2 * oracle->k - 1;
+}
+
+size_t DistanceOracle_bunchSize(const DistanceOracle *oracle)
+{
+    return oracle->bunch_entries;
+}
@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "my_knap_engine.h"
+
+// the links are compacted once there are this many and twice as many as after the last time
+#define FIRST_COMPACT_LINKS (1 << 16)
+
+//------------------------------------------------
+// Links of the sparse dps
+//------------------------------------------------
+
+int knapLinksInit(KnapLinks *links)
+{
+    links->num_links = 0;
+    links->room = 1024;
+    links->compact_at = FIRST_COMPACT_LINKS;
+    links->place = NULL;
+    links->links = malloc(sizeof(KnapLink) * links->room);
+    return links->links != NULL;
+}
+
+void knapLinksFree(KnapLinks *links)
+{
+    free(links->links);
+    free(links->place);
+}
+
+int knapLinkNew(KnapLinks *links, int prev, int item)
+{
+    if (links->num_links == links->room)
+    {
+        size_t room = links->room * 2;
+        if (room > (size_t)INT_MAX)
+            return -1;
+        KnapLink *grown = realloc(links->links, sizeof(KnapLink) * room);
+        if (grown == NULL)
+            return -1;
+        links->links = grown;
+        links->room = room;
+    }
+    links->links[links->num_links].prev = prev;
+    links->links[links->num_links].item = item;
+    return (int)links->num_links++;
+}
+
+/*
+ * Drop the links no pair leads to any more - the ones of dominated pairs. A
+ * link comes after the one it points to, so the links keep their order and one
+ * pass moves them down.
+ */
+int knapLinksCompact(KnapLinks *links, KnapState states[], int size)
+{
+    if (links->num_links < links->compact_at)
+        return TRUE;
+
+    // -1 for a link that is dropped, then the new place of every link kept
+    int *place = realloc(links->place, sizeof(int) * (links->num_links + 1));
+    if (place == NULL)
+        return FALSE;
+    links->place = place;
+    for (size_t link = 0; link < links->num_links; link++)
+    {
+        place[link] = -1;
+    }
+
+    for (int k = 0; k < size; k++)
+    {
+        for (int link = states[k].link; link >= 0 && place[link] < 0; link = links->links[link].prev)
+        {
+            place[link] = 0;
+        }
+    }
+
+    int kept = 0;
+    for (size_t link = 0; link < links->num_links; link++)
+    {
+        if (place[link] < 0)
+            continue;
+        KnapLink moved = links->links[link];
+        if (moved.prev >= 0)
+            moved.prev = place[moved.prev];
+        links->links[kept] = moved;
+        place[link] = kept++;
+    }
+    for (int k = 0; k < size; k++)
+    {
+        if (states[k].link >= 0)
+            states[k].link = place[states[k].link];
+    }
+    links->num_links = kept;
+    links->compact_at = 2 * links->num_links > FIRST_COMPACT_LINKS ? 2 * links->num_links : FIRST_COMPACT_LINKS;
+    return TRUE;
+}
+
+//------------------------------------------------
+// Pareto engine
+//------------------------------------------------
+
+/*
+ * The frontier and the links, grown with realloc - how big they get is only
+ * known on the way, so they don't come from the solver's memory.
+ */
+typedef struct
+{
+    KnapState *list;
+    KnapState *tmp;
+    size_t room;
+    KnapLinks links;
+} Pareto;
+
+static int growLists(Pareto *pareto, size_t size)
+{
+    if (size <= pareto->room)
+        return TRUE;
+    size_t room = pareto->room * 2 > size ? pareto->room * 2 : size;
+    KnapState *list = realloc(pareto->list, sizeof(KnapState) * room);
+    if (list == NULL)
+        return FALSE;
+    pareto->list = list;
+    KnapState *tmp = realloc(pareto->tmp, sizeof(KnapState) * room);
+    if (tmp == NULL)
+        return FALSE;
+    pareto->tmp = tmp;
+    pareto->room = room;
+    return TRUE;
+}
+
+/*
+ * Nemhauser - Ullmann. The frontier is every (weight, value) pair of a subset
+ * of the items so far that no lighter (or as heavy) pair is worth as much as,
+ * sorted by weight with the values going up. Adding an item merges the
+ * frontier with itself shifted by the item - both sorted already, so it is
+ * linear in the frontier - and the time and memory follow the frontier,
+ * which on many instances is much smaller than the capacity. Every pair
+ * remembers the last item it took and the pair it took it on, so the items
+ * of the best pair are found by following the links back.
+ */
+int knapSolvePareto(Knapsack *knap, int n, const long long weights[], const long long values[],
+                    long long capacity, int selected[])
+{
+    return knapPareto(knap, n, weights, values, capacity, LLONG_MAX, selected);
+}
+
+int knapPareto(Knapsack *knap, int n, const long long weights[], const long long values[],
+               long long capacity, long long budget, int selected[])
+{
+    (void)knap;
+    Pareto pareto = {0};
+    int ok = knapLinksInit(&pareto.links) && growLists(&pareto, 1024);
+    int size = 1;
+    if (ok)
+    {
+        pareto.list[0].weight = 0;
+        pareto.list[0].value = 0;
+        pareto.list[0].link = -1;
+    }
+
+    for (int i = 0; i < n && ok; i++)
+    {
+        // the items that weigh nothing are always taken, the ones worth nothing or
+        // heavier than the knapsack never
+        if (values[i] == 0 || weights[i] > capacity)
+            continue;
+        if (weights[i] == 0)
+        {
+            selected[i] = TRUE;
+            continue;
+        }
+
+        ok = growLists(&pareto, 2 * (size_t)size);
+        if (!ok)
+            break;
+        const KnapState *list = pareto.list;
+        KnapState *merged = pareto.tmp;
+        int a = 0;
+        int b = 0;
+        int count = 0;
+        while (a < size || b < size)
+        {
+            // the pairs of the frontier with item i, as long as they fit
+            int with_item = b < size && list[b].weight <= capacity - weights[i];
+            KnapState next;
+            int is_new = FALSE;
+            if (with_item && (a >= size || list[b].weight + weights[i] < list[a].weight))
+            {
+                next.weight = list[b].weight + weights[i];
+                next.value = list[b].value + values[i];
+                next.link = list[b].link;
+                is_new = TRUE;
+                b++;
+            }
+            else if (a < size)
+            {
+                next = list[a++];
+            }
+            else
+            {
+                break;
+            }
+
+            // keep only the pairs worth more than every lighter one
+            if (count > 0 && next.value <= merged[count - 1].value)
+                continue;
+            if (count > 0 && next.weight == merged[count - 1].weight)
+                count--;
+            if (is_new)
+            {
+                next.link = knapLinkNew(&pareto.links, next.link, i);
+                if (next.link < 0)
+                {
+                    ok = FALSE;
+                    break;
+                }
+            }
+            merged[count++] = next;
+        }
+
+        pareto.tmp = pareto.list;
+        pareto.list = merged;
+        size = count;
+        budget -= count;
+        if (budget < 0)
+            ok = FALSE;
+
+        if (ok)
+            ok = knapLinksCompact(&pareto.links, pareto.list, size);
+    }
+
+    // the last pair is the best one that fits
+    if (ok)
+    {
+        const KnapLink *links = pareto.links.links;
+        for (int link = pareto.list[size - 1].link; link >= 0; link = links[link].prev)
+        {
+            selected[links[link].item] = TRUE;
+        }
+    }
+
+    free(pareto.list);
+    free(pareto.tmp);
+    knapLinksFree(&pareto.links);
+    return ok;
+}
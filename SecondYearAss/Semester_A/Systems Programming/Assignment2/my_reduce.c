@@ -0,0 +1,324 @@
+#include <stdlib.h>
+#include <string.h>
+#include "my_knap_engine.h"
+
+// what the reduction decided about a group
+#define GROUP_FREE 0
+#define GROUP_IN 1
+#define GROUP_OUT 2
+
+// an item on its way into a group
+typedef struct
+{
+    long long weight;
+    long long value;
+    int index;
+} ReduceItem;
+
+// same weight and value together, the heavier after, the more valuable first
+static int byWeight(const void *a, const void *b)
+{
+    const ReduceItem *x = a;
+    const ReduceItem *y = b;
+    if (x->weight != y->weight)
+        return x->weight < y->weight ? -1 : 1;
+    if (x->value != y->value)
+        return x->value > y->value ? -1 : 1;
+    return x->index - y->index;
+}
+
+static int byValueDown(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return x > y ? -1 : x < y ? 1 : 0;
+}
+
+// the more valuable per unit of weight first, then the lighter, then the input order
+static int byEfficiency(const void *a, const void *b)
+{
+    const KnapGroup *x = a;
+    const KnapGroup *y = b;
+    __int128 left = (__int128)x->value * y->weight;
+    __int128 right = (__int128)y->value * x->weight;
+    if (left != right)
+        return left > right ? -1 : 1;
+    if (x->weight != y->weight)
+        return x->weight < y->weight ? -1 : 1;
+    return x->first - y->first;
+}
+
+static long long gcd(long long a, long long b)
+{
+    while (b != 0)
+    {
+        long long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/**
+ * Group the useful items and drop the dominated groups
+ * @return the number of groups, -1 if there is not enough memory
+ */
+static int groupItems(Knapsack *knap, int n, const long long weights[], const long long values[],
+                      long long capacity, int selected[], KnapReduction *reduction)
+{
+    ReduceItem *items = knapTake(knap, sizeof(ReduceItem) * (n + 1));
+    KnapGroup *groups = knapTake(knap, sizeof(KnapGroup) * (n + 1));
+    int *members = knapTake(knap, sizeof(int) * (n + 1));
+    long long *ranks = knapTake(knap, sizeof(long long) * (n + 1));
+    long long *tree = knapTake(knap, sizeof(long long) * (n + 2));
+    if (items == NULL || groups == NULL || members == NULL || ranks == NULL || tree == NULL)
+        return -1;
+
+    // the items that weigh nothing are always taken, the ones worth nothing or
+    // heavier than the knapsack never
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (values[i] == 0 || weights[i] > capacity)
+            continue;
+        if (weights[i] == 0)
+        {
+            selected[i] = TRUE;
+            reduction->fixed_value += values[i];
+            continue;
+        }
+        items[count].weight = weights[i];
+        items[count].value = values[i];
+        items[count].index = i;
+        count++;
+    }
+    qsort(items, count, sizeof(ReduceItem), byWeight);
+
+    // the values from high to low, for the tree below
+    for (int k = 0; k < count; k++)
+    {
+        ranks[k] = items[k].value;
+    }
+    qsort(ranks, count, sizeof(long long), byValueDown);
+    memset(tree, 0, sizeof(long long) * (count + 2));
+
+    /*
+     * Item j is dominated by every item before it in this order that is worth at
+     * least as much. An optimal solution can take j only with all of them - any
+     * one left out could take j's place - so if j doesn't fit with all of them
+     * it is never needed. The tree sums the weights of the groups so far by
+     * value rank, up to capacity + 1.
+     */
+    int num_groups = 0;
+    for (int k = 0; k < count;)
+    {
+        KnapGroup group = {items[k].weight, items[k].value, 0, k};
+        for (; k < count && items[k].weight == group.weight && items[k].value == group.value; k++)
+        {
+            members[k] = items[k].index;
+            group.count++;
+        }
+
+        // the rank of the last value >= this one
+        int lo = 0;
+        int hi = count;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (ranks[mid] >= group.value)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        long long dominating = 0;
+        for (int r = lo; r > 0; r -= r & -r)
+        {
+            dominating += tree[r];
+        }
+        if (dominating > capacity - group.weight)
+            continue;
+
+        long long weight = group.count > capacity / group.weight ? capacity + 1 : group.count * group.weight;
+        for (int r = lo; r <= count; r += r & -r)
+        {
+            tree[r] = tree[r] > capacity - weight ? capacity + 1 : tree[r] + weight;
+        }
+        groups[num_groups++] = group;
+    }
+
+    reduction->groups = groups;
+    reduction->members = members;
+    return num_groups;
+}
+
+int knapReduce(Knapsack *knap, int n, const long long weights[], const long long values[],
+               long long capacity, int selected[], KnapReduction *reduction)
+{
+    memset(reduction, 0, sizeof(KnapReduction));
+    int num_groups = groupItems(knap, n, weights, values, capacity, selected, reduction);
+    if (num_groups < 0)
+        return FALSE;
+    reduction->num_groups = num_groups;
+
+    KnapGroup *groups = reduction->groups;
+    int *state = knapTake(knap, sizeof(int) * (num_groups + 1));
+    long long *incumbent = knapTake(knap, sizeof(long long) * (num_groups + 1));
+    reduction->free_groups = knapTake(knap, sizeof(int) * (num_groups + 1));
+    reduction->weights = knapTake(knap, sizeof(long long) * (num_groups + 1));
+    reduction->values = knapTake(knap, sizeof(long long) * (num_groups + 1));
+    reduction->counts = knapTake(knap, sizeof(long long) * (num_groups + 1));
+    if (state == NULL || incumbent == NULL || reduction->free_groups == NULL ||
+        reduction->weights == NULL || reduction->values == NULL || reduction->counts == NULL)
+        return FALSE;
+    reduction->incumbent = incumbent;
+
+    for (int g = 0; g < num_groups; g++)
+    {
+        state[g] = GROUP_FREE;
+        incumbent[g] = 0;
+    }
+    qsort(groups, num_groups, sizeof(KnapGroup), byEfficiency);
+
+    // the break solution - whole groups by efficiency, and as many of the break group as fit
+    int b = 0;
+    long long value = 0;
+    long long weight = 0;
+    for (; b < num_groups; b++)
+    {
+        const KnapGroup *group = &groups[b];
+        long long room = capacity - weight;
+        if (group->count > room / group->weight)
+        {
+            long long copies = room / group->weight;
+            incumbent[b] = copies;
+            value += copies * group->value;
+            weight += copies * group->weight;
+            break;
+        }
+        incumbent[b] = group->count;
+        value += group->count * group->value;
+        weight += group->count * group->weight;
+    }
+
+    // the lower bound - and every later group that still fits
+    long long best = value;
+    long long fill = weight;
+    for (int k = b + 1; k < num_groups; k++)
+    {
+        const KnapGroup *group = &groups[k];
+        long long copies = (capacity - fill) / group->weight;
+        copies = copies < group->count ? copies : group->count;
+        incumbent[k] = copies;
+        best += copies * group->value;
+        fill += copies * group->weight;
+    }
+    reduction->incumbent_value = reduction->fixed_value + best;
+
+    /*
+     * Dembo - Hammer reduction. With the break group's efficiency e, the value of
+     * the break solution + room * e bounds every solution, and changing one item
+     * j from the break solution moves the bound by value_j - weight_j * e. If
+     * putting in one more of a group after the break (or leaving out one of a
+     * group before it) can't beat the lower bound, the whole group is fixed.
+     * The bounds are compared multiplied by the break group's weight.
+     */
+    if (b < num_groups)
+    {
+        const KnapGroup *pivot = &groups[b];
+        __int128 root = (__int128)value * pivot->weight + (__int128)(capacity - weight) * pivot->value;
+        __int128 limit = ((__int128)best + 1) * pivot->weight;
+        for (int k = 0; k < num_groups; k++)
+        {
+            const KnapGroup *group = &groups[k];
+            __int128 gain = (__int128)group->value * pivot->weight - (__int128)group->weight * pivot->value;
+            if (k < b && root - gain < limit)
+                state[k] = GROUP_IN;
+            else if (k > b && root + gain < limit)
+                state[k] = GROUP_OUT;
+        }
+    }
+    else
+    {
+        // everything fits
+        for (int g = 0; g < num_groups; g++)
+        {
+            state[g] = GROUP_IN;
+        }
+    }
+
+    // the fixed groups leave the rest of the capacity to the free ones
+    long long room = capacity;
+    for (int g = 0; g < num_groups; g++)
+    {
+        if (state[g] != GROUP_IN)
+            continue;
+        room -= groups[g].count * groups[g].weight;
+        reduction->fixed_value += groups[g].count * groups[g].value;
+        for (int m = 0; m < groups[g].count; m++)
+        {
+            selected[reduction->members[groups[g].first + m]] = TRUE;
+        }
+    }
+
+    // divide the weights and the capacity by the gcd of the weights, and no more
+    // capacity than all the free groups weigh together
+    long long scale = 0;
+    long long total = 0;
+    int num_free = 0;
+    for (int g = 0; g < num_groups; g++)
+    {
+        if (state[g] != GROUP_FREE || groups[g].weight > room)
+            continue;
+        long long count = groups[g].count < room / groups[g].weight ? groups[g].count : room / groups[g].weight;
+        reduction->free_groups[num_free] = g;
+        reduction->weights[num_free] = groups[g].weight;
+        reduction->values[num_free] = groups[g].value;
+        reduction->counts[num_free] = count;
+        if (total <= room)
+            total += count * groups[g].weight;
+        scale = gcd(groups[g].weight, scale);
+        num_free++;
+    }
+    scale = scale > 0 ? scale : 1;
+    room = total < room ? total : room;
+    for (int k = 0; k < num_free; k++)
+    {
+        reduction->weights[k] /= scale;
+    }
+    reduction->num_free = num_free;
+    reduction->capacity = room / scale;
+    return TRUE;
+}
+
+void knapApplyReduction(const KnapReduction *reduction, const long long taken[], int selected[])
+{
+    long long value = reduction->fixed_value;
+    for (int k = 0; k < reduction->num_free; k++)
+    {
+        value += taken[k] * reduction->values[k];
+    }
+
+    if (value >= reduction->incumbent_value)
+    {
+        for (int k = 0; k < reduction->num_free; k++)
+        {
+            const KnapGroup *group = &reduction->groups[reduction->free_groups[k]];
+            for (int m = 0; m < taken[k]; m++)
+            {
+                selected[reduction->members[group->first + m]] = TRUE;
+            }
+        }
+        return;
+    }
+
+    // the groups fixed by the reduction tests took the lower bound's own solution
+    // out of reach - it was the best after all
+    for (int g = 0; g < reduction->num_groups; g++)
+    {
+        const KnapGroup *group = &reduction->groups[g];
+        for (int m = 0; m < group->count; m++)
+        {
+            selected[reduction->members[group->first + m]] = m < reduction->incumbent[g] ? TRUE : FALSE;
+        }
+    }
+}
@@ -0,0 +1,474 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "my_mat.h"
+
+/*
+ * Out-of-core blocked Floyd-Warshall.
+ *
+ * The distances live in a file of tile x tile blocks of int64 (0 for no path,
+ * like dp). The edges are kept in tiles of their own after them, so a row can
+ * be changed after a solve - every solve copies the edges over the distances
+ * first. For every block of k the three phases of blocked Floyd-Warshall run:
+ *   1. the diagonal tile (kb, kb) by itself
+ *   2. the tiles of row kb and column kb, with the diagonal tile
+ *   3. every other tile (i, j), with (i, kb) and (kb, j)
+ * Phase 3 is most of the work. While one tile is computed, a reader thread
+ * already reads the tiles of the next step into the other buffer slot.
+ */
+
+#define TILES_MAGIC "APSPTILE"
+#define TILES_VERSION 2
+#define TILES_ALIGN 4096
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t n;
+    uint32_t tile;
+    uint32_t solved;
+} TilesHeader;
+
+// the tiles of one phase 3 step - a is only read when the row of tiles changes
+typedef struct
+{
+    int64_t *a; // (i, kb)
+    int64_t *b; // (kb, j)
+    int64_t *c; // (i, j)
+    int ti, tj;
+} TileSlot;
+
+struct _TiledGraph
+{
+    int fd;
+    int n;
+    int tile;
+    int tiles; // tiles per side
+    int solved;
+
+    // reader thread - reads request into slots[request_slot], then sets ready
+    pthread_t reader;
+    int reader_started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int has_request;
+    int ready;
+    int stop;
+    int io_failed;
+    int request_slot;
+    int request_kb;
+    int request_a; // also read the a tile
+
+    TileSlot slots[2];
+};
+
+static size_t tileBytes(const TiledGraph *graph)
+{
+    return sizeof(int64_t) * graph->tile * graph->tile;
+}
+
+static off_t tileOffset(const TiledGraph *graph, int ti, int tj)
+{
+    return TILES_ALIGN + ((off_t)ti * graph->tiles + tj) * (off_t)tileBytes(graph);
+}
+
+// the edge tiles come after the distance tiles, in the same order
+static off_t edgeOffset(const TiledGraph *graph, int ti, int tj)
+{
+    return tileOffset(graph, graph->tiles + ti, tj);
+}
+
+static int readFully(int fd, void *buf, size_t size, off_t offset)
+{
+    char *p = buf;
+    while (size > 0)
+    {
+        ssize_t got = pread(fd, p, size, offset);
+        if (got <= 0)
+            return FALSE;
+        p += got;
+        size -= got;
+        offset += got;
+    }
+    return TRUE;
+}
+
+static int writeFully(int fd, const void *buf, size_t size, off_t offset)
+{
+    const char *p = buf;
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, p, size, offset);
+        if (written <= 0)
+            return FALSE;
+        p += written;
+        size -= written;
+        offset += written;
+    }
+    return TRUE;
+}
+
+static int readTile(TiledGraph *graph, int64_t *buf, int ti, int tj)
+{
+    return readFully(graph->fd, buf, tileBytes(graph), tileOffset(graph, ti, tj));
+}
+
+static int writeTile(TiledGraph *graph, const int64_t *buf, int ti, int tj)
+{
+    return writeFully(graph->fd, buf, tileBytes(graph), tileOffset(graph, ti, tj));
+}
+
+static int writeHeader(TiledGraph *graph)
+{
+    TilesHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TILES_MAGIC, sizeof(header.magic));
+    header.version = TILES_VERSION;
+    header.n = graph->n;
+    header.tile = graph->tile;
+    header.solved = graph->solved;
+    return writeFully(graph->fd, &header, sizeof(header), 0);
+}
+
+//------------------------------------------------
+// Reader thread
+//------------------------------------------------
+
+static void *readerMain(void *arg)
+{
+    TiledGraph *graph = arg;
+
+    pthread_mutex_lock(&graph->lock);
+    while (1)
+    {
+        while (!graph->has_request && !graph->stop)
+            pthread_cond_wait(&graph->cond, &graph->lock);
+        if (graph->stop)
+            break;
+
+        TileSlot *slot = &graph->slots[graph->request_slot];
+        int kb = graph->request_kb;
+        int read_a = graph->request_a;
+        graph->has_request = FALSE;
+        pthread_mutex_unlock(&graph->lock);
+
+        // the reads run without the lock, next to the computation
+        int ok = (!read_a || readTile(graph, slot->a, slot->ti, kb)) &&
+                 readTile(graph, slot->b, kb, slot->tj) &&
+                 readTile(graph, slot->c, slot->ti, slot->tj);
+
+        pthread_mutex_lock(&graph->lock);
+        if (!ok)
+            graph->io_failed = TRUE;
+        graph->ready = TRUE;
+        pthread_cond_broadcast(&graph->cond);
+    }
+    pthread_mutex_unlock(&graph->lock);
+    return NULL;
+}
+
+// ask the reader for the tiles of step (ti, tj) in slot s
+static void requestTiles(TiledGraph *graph, int s, int kb, int ti, int tj, int read_a)
+{
+    pthread_mutex_lock(&graph->lock);
+    graph->slots[s].ti = ti;
+    graph->slots[s].tj = tj;
+    graph->request_slot = s;
+    graph->request_kb = kb;
+    graph->request_a = read_a;
+    graph->ready = FALSE;
+    graph->has_request = TRUE;
+    pthread_cond_broadcast(&graph->cond);
+    pthread_mutex_unlock(&graph->lock);
+}
+
+static int waitTiles(TiledGraph *graph)
+{
+    pthread_mutex_lock(&graph->lock);
+    while (!graph->ready)
+        pthread_cond_wait(&graph->cond, &graph->lock);
+    int ok = !graph->io_failed;
+    pthread_mutex_unlock(&graph->lock);
+    return ok;
+}
+
+//------------------------------------------------
+// TiledGraph
+//------------------------------------------------
+
+TiledGraph *TiledGraph_alloc(const char *path, int n, int tile)
+{
+    if (n <= 0 || tile <= 0)
+        return NULL;
+    if (tile > n)
+        tile = n;
+
+    TiledGraph *graph = calloc(1, sizeof(TiledGraph));
+    if (graph == NULL)
+        return NULL;
+
+    graph->n = n;
+    graph->tile = tile;
+    graph->tiles = (n + tile - 1) / tile;
+    graph->solved = FALSE;
+
+    // an all zero file is a graph without edges (and without paths)
+    graph->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (graph->fd < 0)
+    {
+        free(graph);
+        return NULL;
+    }
+
+    off_t size = edgeOffset(graph, graph->tiles, 0);
+    for (int s = 0; s < 2; s++)
+    {
+        graph->slots[s].a = malloc(tileBytes(graph));
+        graph->slots[s].b = malloc(tileBytes(graph));
+        graph->slots[s].c = malloc(tileBytes(graph));
+    }
+    if (ftruncate(graph->fd, size) != 0 || writeHeader(graph) == FALSE ||
+        graph->slots[0].a == NULL || graph->slots[0].b == NULL || graph->slots[0].c == NULL ||
+        graph->slots[1].a == NULL || graph->slots[1].b == NULL || graph->slots[1].c == NULL)
+    {
+        TiledGraph_free(graph);
+        return NULL;
+    }
+
+    pthread_mutex_init(&graph->lock, NULL);
+    pthread_cond_init(&graph->cond, NULL);
+    if (pthread_create(&graph->reader, NULL, readerMain, graph) != 0)
+    {
+        pthread_mutex_destroy(&graph->lock);
+        pthread_cond_destroy(&graph->cond);
+        TiledGraph_free(graph);
+        return NULL;
+    }
+    graph->reader_started = TRUE;
+    return graph;
+}
+
+void TiledGraph_free(TiledGraph *graph)
+{
+    if (graph == NULL)
+        return;
+
+    if (graph->reader_started)
+    {
+        pthread_mutex_lock(&graph->lock);
+        graph->stop = TRUE;
+        pthread_cond_broadcast(&graph->cond);
+        pthread_mutex_unlock(&graph->lock);
+        pthread_join(graph->reader, NULL);
+        pthread_mutex_destroy(&graph->lock);
+        pthread_cond_destroy(&graph->cond);
+    }
+
+    for (int s = 0; s < 2; s++)
+    {
+        free(graph->slots[s].a);
+        free(graph->slots[s].b);
+        free(graph->slots[s].c);
+    }
+    if (graph->fd >= 0)
+        close(graph->fd);
+    free(graph);
+}
+
+int TiledGraph_setRow(TiledGraph *graph, int i, const int *row)
+{
+    int tile = graph->tile;
+    int ti = i / tile;
+    int64_t *cells = graph->slots[0].c;
+
+    graph->solved = FALSE;
+
+    // row i is one line of tile cells in every tile of tile row ti
+    for (int tj = 0; tj < graph->tiles; tj++)
+    {
+        int count = 0;
+        for (int jj = 0; jj < tile; jj++)
+        {
+            int j = tj * tile + jj;
+            // no edge to itself, and nothing past n
+            cells[count++] = j < graph->n && j != i ? row[j] : 0;
+        }
+        off_t offset = edgeOffset(graph, ti, tj) + (off_t)sizeof(int64_t) * (i % tile) * tile;
+        if (writeFully(graph->fd, cells, sizeof(int64_t) * tile, offset) == FALSE)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static int64_t satAdd(int64_t a, int64_t b)
+{
+    int64_t sum;
+    if (__builtin_add_overflow(a, b, &sum))
+        return a < 0 ? INT64_MIN : INT64_MAX;
+    return sum;
+}
+
+/*
+ * c[i][j] = min(c[i][j], a[i][k] + b[k][j]) for every k of the block, with the
+ * same 0 for no path rules as floydWarshall. a, b and c may be the same tile.
+ * (i0, j0) are the first nodes of c, to skip the diagonal.
+ */
+static void relaxTile(int64_t *c, const int64_t *a, const int64_t *b, int tile, int i0, int j0)
+{
+    for (int k = 0; k < tile; k++)
+    {
+        const int64_t *bk = b + (size_t)k * tile;
+        for (int ii = 0; ii < tile; ii++)
+        {
+            int64_t ik = a[(size_t)ii * tile + k];
+            if (ik == 0)
+                continue;
+
+            int64_t *ci = c + (size_t)ii * tile;
+            for (int jj = 0; jj < tile; jj++)
+            {
+                if (bk[jj] == 0 || i0 + ii == j0 + jj)
+                    continue;
+
+                int64_t through_k = satAdd(ik, bk[jj]);
+                if (ci[jj] == 0 || through_k < ci[jj])
+                    ci[jj] = through_k;
+            }
+        }
+    }
+}
+
+int TiledGraph_solve(TiledGraph *graph)
+{
+    int tile = graph->tile;
+    int tiles = graph->tiles;
+    int64_t *diag = graph->slots[0].a;
+    int64_t *other = graph->slots[0].b;
+
+    // a read that failed in an earlier solve doesn't fail this one - the reader
+    // is idle between solves
+    pthread_mutex_lock(&graph->lock);
+    graph->io_failed = FALSE;
+    pthread_mutex_unlock(&graph->lock);
+
+    // start from the edges - the distances of the last solve may be shorter
+    // than the edges that were changed since
+    for (int ti = 0; ti < tiles; ti++)
+    {
+        for (int tj = 0; tj < tiles; tj++)
+        {
+            if (!readFully(graph->fd, diag, tileBytes(graph), edgeOffset(graph, ti, tj)) ||
+                !writeTile(graph, diag, ti, tj))
+                return FALSE;
+        }
+    }
+
+    for (int kb = 0; kb < tiles; kb++)
+    {
+        int k0 = kb * tile;
+
+        // phase 1 - the diagonal tile
+        if (!readTile(graph, diag, kb, kb))
+            return FALSE;
+        relaxTile(diag, diag, diag, tile, k0, k0);
+        if (!writeTile(graph, diag, kb, kb))
+            return FALSE;
+
+        // phase 2 - row kb and column kb, the diagonal tile stays in memory
+        for (int t = 0; t < tiles; t++)
+        {
+            if (t == kb)
+                continue;
+
+            if (!readTile(graph, other, kb, t))
+                return FALSE;
+            relaxTile(other, diag, other, tile, k0, t * tile);
+            if (!writeTile(graph, other, kb, t))
+                return FALSE;
+
+            if (!readTile(graph, other, t, kb))
+                return FALSE;
+            relaxTile(other, other, diag, tile, t * tile, k0);
+            if (!writeTile(graph, other, t, kb))
+                return FALSE;
+        }
+
+        // phase 3 - every other tile, reading step + 1 while step is computed.
+        // phase 2 used slot 0's buffers, the reader starts on slot 0 again
+        int steps = (tiles - 1) * (tiles - 1);
+        if (steps == 0)
+            continue;
+
+        int step = 0, ti = kb == 0 ? 1 : 0, tj = kb == 0 ? 1 : 0;
+        requestTiles(graph, 0, kb, ti, tj, TRUE);
+        while (step < steps)
+        {
+            int s = step % 2;
+            if (!waitTiles(graph))
+                return FALSE;
+            TileSlot *slot = &graph->slots[s];
+
+            // the next step - the next j of this row, or the first j of the next row
+            int next_ti = ti, next_tj = tj + 1;
+            if (next_tj == kb)
+                next_tj++;
+            if (next_tj >= tiles)
+            {
+                next_ti++;
+                if (next_ti == kb)
+                    next_ti++;
+                next_tj = kb == 0 ? 1 : 0;
+            }
+            int new_row = next_ti != ti;
+            if (step + 1 < steps)
+            {
+                // the a tile of the row is kept - copy it over if the row continues
+                if (!new_row)
+                    memcpy(graph->slots[1 - s].a, slot->a, tileBytes(graph));
+                requestTiles(graph, 1 - s, kb, next_ti, next_tj, new_row);
+            }
+
+            relaxTile(slot->c, slot->a, slot->b, tile, ti * tile, tj * tile);
+            if (!writeTile(graph, slot->c, ti, tj))
+            {
+                // let the reader finish before leaving
+                if (step + 1 < steps)
+                    waitTiles(graph);
+                return FALSE;
+            }
+
+            ti = next_ti;
+            tj = next_tj;
+            step++;
+        }
+    }
+
+    graph->solved = TRUE;
+    return writeHeader(graph);
+}
+
+long long TiledGraph_shortestPath(TiledGraph *graph, int start, int end)
+{
+    int tile = graph->tile;
+    int64_t cell;
+    if (graph->solved == FALSE && TiledGraph_solve(graph) == FALSE)
+        return -1;
+
+    off_t offset = tileOffset(graph, start / tile, end / tile) +
+                   (off_t)sizeof(int64_t) * ((start % tile) * tile + end % tile);
+
+    // not path
+    if (start == end || readFully(graph->fd, &cell, sizeof(cell), offset) == FALSE || cell == 0)
+        return -1;
+    return cell;
+}
+
+int TiledGraph_isPathExists(TiledGraph *graph, int start, int end)
+{
+    return TiledGraph_shortestPath(graph, start, end) != -1 ? TRUE : FALSE;
+}
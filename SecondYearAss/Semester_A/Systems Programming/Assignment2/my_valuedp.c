@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <limits.h>
+#include "my_knap_engine.h"
+
+// the rows of one solve of the value dp, and its items
+typedef struct
+{
+    const long long *weights;
+    const long long *values;
+    long long capacity;
+    long long *rows[2];
+} ValueWork;
+
+/**
+ * The least weight of items [lo, hi) worth at least t, for every t = 0..target -
+ * capacity + 1 for none that fit. Worth at least, so a value above target
+ * still counts for target and the row never needs more than target + 1 cells.
+ */
+static void valueForward(const ValueWork *work, int lo, int hi, long long target, long long *row)
+{
+    row[0] = 0;
+    for (long long t = 1; t <= target; t++)
+    {
+        row[t] = work->capacity + 1;
+    }
+
+    for (int i = lo; i < hi; i++)
+    {
+        long long weight = work->weights[i];
+        long long value = work->values[i];
+        // from the top down, so every cell looks at the row before item i
+        for (long long t = target; t > 0; t--)
+        {
+            long long take = row[t > value ? t - value : 0] + weight;
+            if (take < row[t])
+                row[t] = take;
+        }
+    }
+}
+
+/**
+ * Hirschberg over the values - the items [lo, mid) get the part of target
+ * the halves reach with the least weight together, and [mid, hi) the rest
+ * @param target a value the items reach within capacity
+ */
+static void valueRange(ValueWork *work, int lo, int hi, long long target, long long capacity, int selected[])
+{
+    if (target <= 0 || hi <= lo)
+        return;
+    if (hi - lo == 1)
+    {
+        selected[lo] = TRUE;
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    long long *left = work->rows[0];
+    long long *right = work->rows[1];
+    valueForward(work, lo, mid, target, left);
+    valueForward(work, mid, hi, target, right);
+
+    long long split = 0;
+    long long least = work->capacity + 1;
+    for (long long a = 0; a <= target; a++)
+    {
+        if (left[a] + right[target - a] < least)
+        {
+            least = left[a] + right[target - a];
+            split = a;
+        }
+    }
+    long long left_weight = left[split];
+
+    valueRange(work, lo, mid, split, left_weight, selected);
+    valueRange(work, mid, hi, target - split, capacity - left_weight, selected);
+}
+
+/*
+ * The dp over the values instead of the capacities - the least weight for every
+ * value, n * (sum of the values) time, for heavy items that aren't worth much.
+ * The best value is the highest one whose weight fits.
+ */
+int knapSolveValueDp(Knapsack *knap, int n, const long long weights[], const long long values[],
+                     long long capacity, int selected[])
+{
+    return knapValueDp(knap, n, weights, values, capacity, LLONG_MAX, selected);
+}
+
+int knapValueDp(Knapsack *knap, int n, const long long weights[], const long long values[],
+                long long capacity, long long limit, int selected[])
+{
+    // the items that weigh nothing are always taken, the ones worth nothing or
+    // heavier than the knapsack never
+    long long *item_weights = knapTake(knap, sizeof(long long) * (n + 1));
+    long long *item_values = knapTake(knap, sizeof(long long) * (n + 1));
+    int *index = knapTake(knap, sizeof(int) * (n + 1));
+    int *item_selected = knapTake(knap, sizeof(int) * (n + 1));
+    if (item_weights == NULL || item_values == NULL || index == NULL || item_selected == NULL)
+        return FALSE;
+
+    int count = 0;
+    long long total = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (values[i] == 0 || weights[i] > capacity)
+            continue;
+        if (weights[i] == 0)
+        {
+            selected[i] = TRUE;
+            continue;
+        }
+        item_weights[count] = weights[i];
+        item_values[count] = values[i];
+        item_selected[count] = FALSE;
+        index[count] = i;
+        total = values[i] > limit - total ? limit : total + values[i];
+        count++;
+    }
+    if (total >= (long long)(SIZE_MAX / sizeof(long long) / 2))
+        return FALSE;
+
+    // the weights in the rows are at most capacity + 1, so no sum of two overflows
+    if (capacity >= LLONG_MAX / 2)
+        return FALSE;
+
+    ValueWork work = {item_weights, item_values, capacity, {NULL, NULL}};
+    work.rows[0] = knapTake(knap, sizeof(long long) * (total + 1));
+    work.rows[1] = knapTake(knap, sizeof(long long) * (total + 1));
+    if (work.rows[0] == NULL || work.rows[1] == NULL)
+        return FALSE;
+
+    valueForward(&work, 0, count, total, work.rows[0]);
+    long long best = total;
+    while (work.rows[0][best] > capacity)
+    {
+        best--;
+    }
+
+    valueRange(&work, 0, count, best, capacity, item_selected);
+    for (int k = 0; k < count; k++)
+    {
+        if (item_selected[k] == TRUE)
+            selected[index[k]] = TRUE;
+    }
+    return TRUE;
+}
@@ -117,8 +117,7 @@ int main(void) {
         StrList_reverse(list);
         break;
       case 11:
-        StrList_free(list);
-        list = StrList_alloc();
+        StrList_clear(list);
         break;
       case 12:
         StrList_sort(list);
@@ -1,50 +1,374 @@
 #include "StrList.h"
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// the number of strings a node holds at first - 64 pointers are 512 bytes, so
+// going over the strings of a node is a few cache lines instead of a miss for
+// each. It doubles as the list grows, so there are about sqrt n nodes of about
+// sqrt n strings
+#define FIRST_NODE_CAPACITY 64
+
+// the room the chunk-offset index starts with
+#define FIRST_INDEX_ROOM 16
+
+// the size of a region of the arena - a block bigger than a quarter of it
+// gets a region of its own
+#define REGION_SIZE (1 << 16)
+
+// the blocks of the arena are multiples of this, so a block is aligned for
+// anything that is put in it
+#define ARENA_ALIGN 16
+
+// the size classes of the strings: the first ones are every 16 bytes up to
+// 512, the ones after them are powers of two
+#define SMALL_CLASSES 32
+#define NUM_CLASSES 64
+
 // Node & List Data Structures
+// an unrolled list - every node holds a chunk of the strings, and no node is
+// ever empty
 typedef struct _node {
-  char *_data;
+  int _count;
   struct _node *_next;
+  char *_data[];  // the strings of the node, _data[0.._count), with room for
+                  // the _capacity of the list
 } Node;
 
+// a string in the arena - the size class of its block and the chars, in one
+// block
+typedef struct {
+  unsigned char _class;
+  char _data[];
+} Entry;
+
+// a block that was freed, in the free list of its size class
+typedef struct _block {
+  struct _block *_next;
+} Block;
+
+// a region of the arena, the blocks are taken from _bytes one after the other
+// (the two fields before it keep _bytes aligned to 16)
+typedef struct _region {
+  struct _region *_next;
+  size_t _size;  // the number of bytes in _bytes
+  char _bytes[];
+} Region;
+
 struct _StrList {
   Node *_head;
+  Node *_tail;
   size_t _size;
+  int _capacity;  // the room for strings in every node
+  // the chunk-offset index: _index[k] is the k-th node and _start[k] is the
+  // index of its first string in the list, so the node of an index is found
+  // with a binary search instead of walking from the head
+  Node **_index;
+  size_t *_start;
+  size_t _nodes;  // the number of nodes
+  size_t _room;   // the room in _index and _start
+  // the arena the nodes and the strings are taken from: the region taken
+  // from now and _used bytes of it, the regions that were taken from
+  // (_fullTail is the last one), the ones kept for later by StrList_clear and
+  // the regions of the big blocks
+  Region *_region;
+  size_t _used;
+  Region *_full;
+  Region *_fullTail;
+  Region *_kept;
+  Region *_large;
+  // the nodes and the strings that were removed, to be taken again - the
+  // strings by the size class of their block
+  Node *_freeNodes;
+  Block *_freeBlocks[NUM_CLASSES];
 };
 //------------------------------------------------
-// Node implementation
+// Arena implementation
 //------------------------------------------------
 
-Node *Node_alloc(const char *data, Node *next) {
-  // allocate memory for the node
-  Node *p = (Node *)malloc(sizeof(Node));
-  if (p == NULL) {  // if malloc fails
+Region *Region_alloc(size_t size) {
+  Region *region = (Region *)malloc(sizeof(Region) + size);
+  if (region == NULL) {  // if malloc fails
     return NULL;
   }
-  p->_data = strdup(data);  // strdup allocates memory for the string and copies
-                            // the string to the allocated memory
-  if (p->_data == NULL) {   // if strdup fails
-    free(p);
-    return NULL;
+  region->_next = NULL;
+  region->_size = size;
+  return region;
+}
+
+void Region_freeAll(Region *region) {
+  while (region != NULL) {
+    Region *next = region->_next;
+    free(region);
+    region = next;
   }
+}
+
+// put a region in the list of the regions that were taken from
+void Arena_pushFull(StrList *list, Region *region) {
+  region->_next = list->_full;
+  list->_full = region;
+  if (list->_fullTail == NULL) {
+    list->_fullTail = region;
+  }
+}
+
+// take a block of size bytes from the arena, returns NULL if malloc fails
+void *Arena_take(StrList *list, size_t size) {
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+  // a big block gets a region of its own
+  if (size > REGION_SIZE / 4) {
+    Region *region = Region_alloc(size);
+    if (region == NULL) return NULL;
+    region->_next = list->_large;
+    list->_large = region;
+    return region->_bytes;
+  }
+
+  // if the region is full, go on to a kept region or to a new one
+  if (list->_region == NULL || list->_used + size > list->_region->_size) {
+    Region *region = list->_kept;
+    if (region != NULL) {
+      list->_kept = region->_next;
+    } else {
+      region = Region_alloc(REGION_SIZE);
+      if (region == NULL) return NULL;
+    }
+    if (list->_region != NULL) {
+      Arena_pushFull(list, list->_region);
+    }
+    list->_region = region;
+    list->_used = 0;
+  }
+
+  void *block = list->_region->_bytes + list->_used;
+  list->_used += size;
+  return block;
+}
+
+// the size class of a block of size bytes
+int Arena_class(size_t size) {
+  if (size <= SMALL_CLASSES * ARENA_ALIGN) {
+    return (size + ARENA_ALIGN - 1) / ARENA_ALIGN - 1;
+  }
+  int c = SMALL_CLASSES;
+  size_t classSize = 2 * SMALL_CLASSES * ARENA_ALIGN;
+  while (classSize < size) {
+    classSize *= 2;
+    c++;
+  }
+  return c;
+}
+
+// the size of the blocks of a size class
+size_t Arena_classSize(int c) {
+  if (c < SMALL_CLASSES) {
+    return (size_t)(c + 1) * ARENA_ALIGN;
+  }
+  return (size_t)SMALL_CLASSES * ARENA_ALIGN << (c - SMALL_CLASSES + 1);
+}
+
+// copy a string to a block of the arena - a removed one of its size class if
+// there is one - returns NULL if malloc fails
+char *String_alloc(StrList *list, const char *data) {
+  size_t length = strlen(data);
+  int c = Arena_class(offsetof(Entry, _data) + length + 1);
+
+  Entry *entry = (Entry *)list->_freeBlocks[c];
+  if (entry != NULL) {
+    list->_freeBlocks[c] = list->_freeBlocks[c]->_next;
+  } else {
+    entry = (Entry *)Arena_take(list, Arena_classSize(c));
+    if (entry == NULL) return NULL;
+  }
+  entry->_class = c;
+  memcpy(entry->_data, data, length + 1);
+  return entry->_data;
+}
+
+// put the block of a string in the free list of its size class
+void String_free(StrList *list, char *data) {
+  Entry *entry = (Entry *)(data - offsetof(Entry, _data));
+  int c = entry->_class;  // read before the block is written over
+  Block *block = (Block *)entry;
+  block->_next = list->_freeBlocks[c];
+  list->_freeBlocks[c] = block;
+}
+
+//------------------------------------------------
+
+//------------------------------------------------
+// Node implementation
+//------------------------------------------------
+
+Node *Node_alloc(StrList *list, Node *next) {
+  // take a removed node if there is one, else a new one from the arena - the
+  // strings are added by the list
+  Node *p = list->_freeNodes;
+  if (p != NULL) {
+    list->_freeNodes = p->_next;
+  } else {
+    p = (Node *)Arena_take(list, sizeof(Node) + list->_capacity * sizeof(char *));
+    if (p == NULL) {  // if malloc fails
+      return NULL;
+    }
+  }
+  p->_count = 0;
 
   // point to the next node that is passed as an argument
   p->_next = next;
   return p;
 }
 
-void Node_free(Node *node) {
+void Node_free(StrList *list, Node *node) {
   if (node != NULL) {
-    free(node->_data);
-    free(node);
+    for (int i = 0; i < node->_count; i++) {
+      String_free(list, node->_data[i]);
+    }
+    // the node is kept to be taken again
+    node->_next = list->_freeNodes;
+    list->_freeNodes = node;
   }
 }
 
 //------------------------------------------------
 
+//------------------------------------------------
+// Chunk-offset index
+//------------------------------------------------
+
+// make room in the index for one more node, returns 0 if realloc fails
+int Index_reserve(StrList *list) {
+  if (list->_nodes < list->_room) return 1;
+
+  size_t room = list->_room == 0 ? FIRST_INDEX_ROOM : list->_room * 2;
+  Node **index = (Node **)realloc(list->_index, room * sizeof(Node *));
+  if (index == NULL) return 0;
+  list->_index = index;
+  size_t *start = (size_t *)realloc(list->_start, room * sizeof(size_t));
+  if (start == NULL) return 0;
+  list->_start = start;
+  list->_room = room;
+  return 1;
+}
+
+// put the node after node number k in the index (it is already linked)
+void Index_insert(StrList *list, size_t k, Node *node, size_t start) {
+  // move the nodes after k one place up
+  memmove(list->_index + k + 2, list->_index + k + 1,
+          (list->_nodes - k - 1) * sizeof(Node *));
+  memmove(list->_start + k + 2, list->_start + k + 1,
+          (list->_nodes - k - 1) * sizeof(size_t));
+  list->_index[k + 1] = node;
+  list->_start[k + 1] = start;
+  list->_nodes++;
+}
+
+// build the index again from the nodes, after changes all over the list
+// (the nodes are never more than before, so there is room for them)
+void Index_rebuild(StrList *list) {
+  size_t k = 0;
+  size_t start = 0;
+  for (Node *p = list->_head; p != NULL; p = p->_next) {
+    list->_index[k] = p;
+    list->_start[k] = start;
+    start += p->_count;
+    k++;
+  }
+  list->_nodes = k;
+}
+
+// returns the number of the node that holds the string at the given index
+// (the index must be in the list)
+size_t Index_find(const StrList *list, size_t index) {
+  // the last node that starts at index or before it
+  size_t low = 0;
+  size_t high = list->_nodes - 1;
+  while (low < high) {
+    size_t mid = (low + high + 1) / 2;
+    if (list->_start[mid] <= index) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
+// unlink and free node number k, which has no strings left
+void Index_removeNode(StrList *list, size_t k) {
+  Node *node = list->_index[k];
+  Node *prev = k > 0 ? list->_index[k - 1] : NULL;
+
+  // point the previous node (or the head) to the next node
+  if (prev == NULL) {
+    list->_head = node->_next;
+  } else {
+    prev->_next = node->_next;
+  }
+  if (list->_tail == node) {
+    list->_tail = prev;
+  }
+
+  // move the nodes after k one place down
+  memmove(list->_index + k, list->_index + k + 1,
+          (list->_nodes - k - 1) * sizeof(Node *));
+  memmove(list->_start + k, list->_start + k + 1,
+          (list->_nodes - k - 1) * sizeof(size_t));
+  list->_nodes--;
+  Node_free(list, node);
+}
+
+//------------------------------------------------
+
+// move the strings to new full nodes of twice the capacity, as many times as
+// it takes for the capacity to be at least sqrt n - called when there are
+// more than twice as many nodes as the capacity, so the nodes are about sqrt n
+// again, and it is done once in O(n) inserts. The old nodes are left in the
+// arena (they are too small to be taken again), and if the arena runs out the
+// nodes stay as they are
+void List_grow(StrList *list) {
+  size_t capacity = list->_capacity;
+  while (capacity * capacity < list->_size) {
+    capacity *= 2;
+  }
+
+  // all the new nodes first, so the list is not changed if one is missing
+  size_t count = (list->_size + capacity - 1) / capacity;
+  Node *head = NULL;
+  for (size_t k = 0; k < count; k++) {
+    Node *node =
+        (Node *)Arena_take(list, sizeof(Node) + capacity * sizeof(char *));
+    if (node == NULL) return;
+    node->_count = 0;
+    node->_next = head;
+    head = node;
+  }
+
+  // fill them in order
+  Node *write = head;
+  for (Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    for (int i = 0; i < temp->_count; i++) {
+      if (write->_count == (int)capacity) {
+        write = write->_next;
+      }
+      write->_data[write->_count++] = temp->_data[i];
+    }
+  }
+
+  list->_head = head;
+  list->_tail = write;
+  list->_capacity = (int)capacity;
+  list->_freeNodes = NULL;
+  Index_rebuild(list);
+}
+
+//------------------------------------------------
+
 //------------------------------------------------
 // List implementation
 //------------------------------------------------
@@ -53,47 +377,107 @@ StrList *StrList_alloc() {
   // allocate memory for the list
   StrList *p = (StrList *)malloc(sizeof(StrList));
   p->_head = NULL;
+  p->_tail = NULL;
   p->_size = 0;
+  p->_capacity = FIRST_NODE_CAPACITY;
+  p->_index = NULL;
+  p->_start = NULL;
+  p->_nodes = 0;
+  p->_room = 0;
+  p->_region = NULL;
+  p->_used = 0;
+  p->_full = NULL;
+  p->_fullTail = NULL;
+  p->_kept = NULL;
+  p->_large = NULL;
+  p->_freeNodes = NULL;
+  memset(p->_freeBlocks, 0, sizeof(p->_freeBlocks));
   return p;
 }
 
 void StrList_free(StrList *list) {
   if (list == NULL) return;
-  Node *p1 = list->_head;  // point to the first node
-  Node *p2;                // helper pointer to free the nodes
 
-  // free all the nodes in the list
-  while (p1) {
-    p2 = p1;         // point to the current node
-    p1 = p1->_next;  // point to the next node
-    Node_free(p2);   // free the current node (p2 points to the current node)
-  }
+  // the nodes and the strings are all in the regions of the arena, so freeing
+  // the regions frees them all - no walking over the nodes
+  free(list->_region);
+  Region_freeAll(list->_full);
+  Region_freeAll(list->_kept);
+  Region_freeAll(list->_large);
 
-  // after freeing all the nodes, free the list
+  // free the index and the list
+  free(list->_index);
+  free(list->_start);
   free(list);
 }
 
+void StrList_clear(StrList *list) {
+  if (list == NULL) return;
+
+  // all the regions are kept to be taken from again - the one taken from now
+  // and the full ones go before the ones kept already
+  if (list->_region != NULL) {
+    Arena_pushFull(list, list->_region);
+  }
+  if (list->_full != NULL) {
+    list->_fullTail->_next = list->_kept;
+    list->_kept = list->_full;
+  }
+  list->_region = NULL;
+  list->_used = 0;
+  list->_full = NULL;
+  list->_fullTail = NULL;
+
+  // the regions of the big blocks are freed - they would not be taken from
+  // again, and there are few of them (every one is over a quarter region)
+  Region_freeAll(list->_large);
+  list->_large = NULL;
+
+  // the free lists are in the regions too, so they start again empty
+  list->_freeNodes = NULL;
+  memset(list->_freeBlocks, 0, sizeof(list->_freeBlocks));
+
+  // the list is empty, the room of the index stays
+  list->_head = NULL;
+  list->_tail = NULL;
+  list->_size = 0;
+  list->_capacity = FIRST_NODE_CAPACITY;
+  list->_nodes = 0;
+}
+
 size_t StrList_size(const StrList *list) { return list->_size; }
 
 void StrList_insertLast(StrList *list, const char *data) {
-  // allocate memory for the new node
-  Node *newNode = Node_alloc(data, NULL);
-  // if malloc fails, return
-  if (newNode == NULL) {
+  // copy the string to the arena of the list
+  char *copy = String_alloc(list, data);
+  if (copy == NULL) {  // if malloc fails, return
     return;
   }
 
-  // if the list is empty, point the head to the new node
-  if (list->_head == NULL) {
-    list->_head = newNode;
-  } else {
-    Node *temp = list->_head;
-
-    while (temp->_next != NULL) {
-      temp = temp->_next;
+  // if the list is empty or the last node is full, add a new node at the end -
+  // the tail pointer makes it O(1), no walking from the head
+  if (list->_nodes > 2 * (size_t)list->_capacity) {
+    List_grow(list);
+  }
+  Node *tail = list->_tail;
+  if (tail == NULL || tail->_count == list->_capacity) {
+    Node *newNode = Index_reserve(list) ? Node_alloc(list, NULL) : NULL;
+    if (newNode == NULL) {
+      String_free(list, copy);
+      return;
     }
-    temp->_next = newNode;
+    if (tail == NULL) {
+      list->_head = newNode;
+    } else {
+      tail->_next = newNode;
+    }
+    list->_index[list->_nodes] = newNode;
+    list->_start[list->_nodes] = list->_size;
+    list->_nodes++;
+    list->_tail = tail = newNode;
   }
+
+  tail->_data[tail->_count++] = copy;
   list->_size++;  // increment the size of the list
 }
 
@@ -104,37 +488,65 @@ void StrList_insertAt(StrList *list, const char *data, int index) {
     // exit(OUT_OF_BOUNDS);
   }
 
-  // if the index is the size of the list, the new node is inserted at the
+  // if the index is the size of the list, the new string is inserted at the
   // end
   if (index == list->_size) {
     StrList_insertLast(list, data);
     return;
   }
-  // allocate memory for the new node - for now the next pointer is NULL
-  Node *newNode = Node_alloc(data, NULL);
 
+  char *copy = String_alloc(list, data);
   // check if malloc fails
-  if (newNode == NULL) {
+  if (copy == NULL) {
     return;  // TODO: check what to do
     // exit(ALLOCATION_FAILED);
   }
 
-  if (index == 0) {  // if the index is 0, the new node becomes the head
-    newNode->_next = list->_head;
-    list->_head = newNode;
-  } else {  // if the index is not 0, we need to find the node before the
-            // index``
-    Node *temp = list->_head;
-    for (size_t i = 0; i < index - 1; i++) {  // find the node before the index
-      temp = temp->_next;
+  // find the node of the index and the place in it
+  if (list->_nodes > 2 * (size_t)list->_capacity) {
+    List_grow(list);
+  }
+  size_t k = Index_find(list, index);
+  Node *node = list->_index[k];
+  int slot = index - list->_start[k];
+
+  // a full node is split in two halves, and the string goes to the half it is
+  // in
+  int capacity = list->_capacity;
+  if (node->_count == capacity) {
+    Node *newNode = Index_reserve(list) ? Node_alloc(list, node->_next) : NULL;
+    if (newNode == NULL) {
+      String_free(list, copy);
+      return;
     }
+    int half = capacity / 2;
+    memcpy(newNode->_data, node->_data + half,
+           (capacity - half) * sizeof(char *));
+    newNode->_count = capacity - half;
+    node->_count = half;
+    node->_next = newNode;
+    if (list->_tail == node) {
+      list->_tail = newNode;
+    }
+    Index_insert(list, k, newNode, list->_start[k] + half);
 
-    // point the new node to the node after the index
-    newNode->_next = temp->_next;
-    // point the node before the index to the new node
-    temp->_next = newNode;
+    if (slot > half) {
+      k++;
+      node = newNode;
+      slot -= half;
+    }
   }
 
+  // move the strings after the slot one place up and put the new one there
+  memmove(node->_data + slot + 1, node->_data + slot,
+          (node->_count - slot) * sizeof(char *));
+  node->_data[slot] = copy;
+  node->_count++;
+
+  // the nodes after it start one index later
+  for (size_t j = k + 1; j < list->_nodes; j++) {
+    list->_start[j]++;
+  }
   list->_size++;  // increment the size of the list
 }
 
@@ -143,25 +555,26 @@ char *StrList_firstData(const StrList *list) {
     return NULL;
   }
 
-  // return the data of the first node
-  return list->_head->_data;
+  // return the first string of the first node
+  return list->_head->_data[0];
 }
 
 void StrList_print(const StrList *list) {
-  // if the list is empty, print ] and return
+  // if the list is empty, print an empty line and return
   if (list->_head == NULL) {
     printf("\n");
     return;
   }
 
-  // loop through the list and print the data of each node
-  Node *temp = list->_head;
-  while (temp->_next != NULL) {  // loop until the second to last node
-    printf("%s ", temp->_data);
-    temp = temp->_next;
+  // loop through the nodes and print their strings, with a space between
+  const char *separator = "";
+  for (const Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    for (int i = 0; i < temp->_count; i++) {
+      printf("%s%s", separator, temp->_data[i]);
+      separator = " ";
+    }
   }
-  // print the data of the last node and ]
-  printf("%s\n", temp->_data);
+  printf("\n");
 }
 
 void StrList_printAt(const StrList *list, int index) {
@@ -171,77 +584,77 @@ void StrList_printAt(const StrList *list, int index) {
     // exit(OUT_OF_BOUNDS);
   }
 
-  // loop through the list until the index
-  Node *temp = list->_head;
-  for (size_t i = 0; i < index; i++) {
-    temp = temp->_next;
-  }
-  // print the data of the node at the index
-  printf("%s\n", temp->_data);
+  // find the node of the index and print the string at the index
+  size_t k = Index_find(list, index);
+  printf("%s\n", list->_index[k]->_data[index - list->_start[k]]);
 }
 
 int StrList_printLen(const StrList *list) {
   int sum = 0;
-  Node *temp = list->_head;
-  while (temp != NULL) {
-    sum += strlen(temp->_data);
-    temp = temp->_next;
+  for (const Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    for (int i = 0; i < temp->_count; i++) {
+      sum += strlen(temp->_data[i]);
+    }
   }
   return sum;
 }
 
 int StrList_count(StrList *list, const char *data) {
   int count = 0;
-  Node *temp = list->_head;
-  while (temp != NULL) {
-    if (strcmp(data, temp->_data) == 0) {
-      count++;
+  for (const Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    for (int i = 0; i < temp->_count; i++) {
+      if (strcmp(data, temp->_data[i]) == 0) {
+        count++;
+      }
     }
-    temp = temp->_next;
   }
   return count;
 }
 
 void StrList_remove(StrList *list, const char *data) {
-  // remove all the firsts elements that equals to data
-  Node *temp = list->_head;
-  while (temp != NULL && strcmp(temp->_data, data) == 0) {
-    Node *toDelete = temp;  // save the node to delete
-    temp = temp->_next;     // go to the next node
-    Node_free(toDelete);    // free the node that was saved
-    list->_size--;          // decrement the size of the list
-  }
-  list->_head = temp;  // update the head
-
-  // remove all the elements that equals to data after the firsts elements that
-  // equals to data
-
-  Node *prev = temp;  // save the previous node so we can point to the next node
-  // temp can be NULL if the list is empty after removing the firsts elements
-  // that equals to data
-  if (temp != NULL) {
-    temp = temp->_next;
+  if (list->_head == NULL) return;
+
+  // go over all the strings and move the ones that stay to the front, so the
+  // nodes stay full - write is the node they are moved to and w the place in it
+  Node *write = list->_head;
+  int w = 0;
+  for (Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    for (int i = 0; i < temp->_count; i++) {
+      if (strcmp(temp->_data[i], data) == 0) {
+        // free the string that is removed
+        String_free(list, temp->_data[i]);
+        list->_size--;         // decrement the size of the list
+        continue;
+      }
+      // write is never after temp, so a full write node was already read
+      if (w == list->_capacity) {
+        write->_count = w;
+        write = write->_next;
+        w = 0;
+      }
+      write->_data[w++] = temp->_data[i];
+    }
   }
 
-  // loop through the list and remove the elements that equals to data
+  // the nodes after the last one written to have no strings left
+  Node *temp = write->_next;
   while (temp != NULL) {
-    // if the data of the current node equals to data
-    if (strcmp(temp->_data, data) == 0) {
-      prev->_next =
-          temp->_next;  // point the previous node to the current next node
-      Node_free(temp);  // free the current node
-
-      temp = prev->_next;  // point to the next node
-
-      list->_size--;  // decrement the size of the list
-    } else {
-      // if the data of the current node is different from data
-      // we need the else because we update the temp pointer in the if
-      // statement, and maybe he equal to data, so we need to check again
-      prev = temp;
-      temp = temp->_next;
-    }
+    Node *toDelete = temp;
+    temp = temp->_next;
+    toDelete->_count = 0;
+    Node_free(list, toDelete);
+  }
+  if (w == 0) {  // nothing is left
+    write->_count = 0;
+    Node_free(list, write);
+    list->_head = NULL;
+    list->_tail = NULL;
+  } else {
+    write->_count = w;
+    write->_next = NULL;
+    list->_tail = write;
   }
+  Index_rebuild(list);
 }
 
 void StrList_removeAt(StrList *list, int index) {
@@ -252,25 +665,35 @@ void StrList_removeAt(StrList *list, int index) {
     // exit(OUT_OF_BOUNDS);
   }
 
-  // if the index is 0, remove the head and point the head to the next node
-  if (index == 0) {
-    Node *toDelete = list->_head;      // save the node to delete
-    list->_head = list->_head->_next;  // point the head to the next node
-    Node_free(toDelete);               // free the node that was saved
-    list->_size--;                     // decrement the size of the list
-    return;                            // exit the function
-  }
+  // find the node of the index and the place in it
+  size_t k = Index_find(list, index);
+  Node *node = list->_index[k];
+  int slot = index - list->_start[k];
 
-  // loop through the list until the we get to the parent of StrList[index]
-  Node *temp = list->_head;
-  for (size_t i = 0; i < index - 1; i++) {
-    temp = temp->_next;
+  // free the string and move the strings after it one place down
+  String_free(list, node->_data[slot]);
+  memmove(node->_data + slot, node->_data + slot + 1,
+          (node->_count - slot - 1) * sizeof(char *));
+  node->_count--;
+
+  // the nodes after it start one index earlier
+  for (size_t j = k + 1; j < list->_nodes; j++) {
+    list->_start[j]--;
   }
+  list->_size--;  // decrement the size of the list
 
-  Node *toDelete = temp->_next;      // save the node to delete
-  temp->_next = temp->_next->_next;  // point the previous node to the next node
-  Node_free(toDelete);               // free the node that was saved
-  list->_size--;                     // decrement the size of the list
+  // a node that is left with few strings takes the strings of the next node
+  // if they all fit in half a node, so the nodes don't get almost empty
+  Node *next = node->_next;
+  if (next != NULL && node->_count + next->_count <= list->_capacity / 2) {
+    memcpy(node->_data + node->_count, next->_data,
+           next->_count * sizeof(char *));
+    node->_count += next->_count;
+    next->_count = 0;
+    Index_removeNode(list, k + 1);
+  } else if (node->_count == 0) {
+    Index_removeNode(list, k);
+  }
 }
 
 int StrList_isEqual(const StrList *list1, const StrList *list2) {
@@ -280,16 +703,23 @@ int StrList_isEqual(const StrList *list1, const StrList *list2) {
     return 0;
   }
 
-  // loop through the lists and compare the data of each node
-  Node *temp1 = list1->_head;
-  Node *temp2 = list2->_head;
-
-  while (temp1 != NULL && temp2 != NULL) {
-    // if the data of the current node is different, the lists are different
-    if (strcmp(temp1->_data, temp2->_data) != 0) return 0;
-
-    temp1 = temp1->_next;
-    temp2 = temp2->_next;
+  // loop through the lists and compare the strings one by one - the nodes of
+  // the lists don't have to hold the same number of strings
+  const Node *temp1 = list1->_head;
+  const Node *temp2 = list2->_head;
+  int i1 = 0;
+  int i2 = 0;
+  for (size_t i = 0; i < list1->_size; i++) {
+    if (i1 == temp1->_count) {
+      temp1 = temp1->_next;
+      i1 = 0;
+    }
+    if (i2 == temp2->_count) {
+      temp2 = temp2->_next;
+      i2 = 0;
+    }
+    // if the strings are different, the lists are different
+    if (strcmp(temp1->_data[i1++], temp2->_data[i2++]) != 0) return 0;
   }
 
   // if we get to the end of the lists, the lists are equal
@@ -299,29 +729,17 @@ int StrList_isEqual(const StrList *list1, const StrList *list2) {
 StrList *StrList_clone(const StrList *list) {
   StrList *clone = StrList_alloc();  // allocate memory for the clone
 
-  // set the size of the clone to the size of the list
-  clone->_size = list->_size;
-
-  // temp pointer to loop through the list
-  const Node *old = list->_head;
-
-  // copy pointer to loop through the clone
-  Node **copy = &(clone->_head);
-
-  // loop through the list and copy the data of each node to the clone
-  while (old != NULL) {
-    // allocate memory for the new node and copy the data of the current node
-    *copy = Node_alloc(old->_data, NULL);
-    // if malloc fails, free the memory allocated to the nodes and the list
-    if (*copy == NULL) {
-      StrList_free(clone);
-      return NULL;
+  // copy the strings to the end of the clone, which fills its nodes
+  for (const Node *old = list->_head; old != NULL; old = old->_next) {
+    for (int i = 0; i < old->_count; i++) {
+      size_t size = clone->_size;
+      StrList_insertLast(clone, old->_data[i]);
+      // if malloc fails, free the memory allocated to the nodes and the list
+      if (clone->_size == size) {
+        StrList_free(clone);
+        return NULL;
+      }
     }
-    // continue to the next node
-    old = old->_next;
-
-    // point to the next node of the clone
-    copy = &((*copy)->_next);
   }
   return clone;
 }
@@ -331,7 +749,16 @@ void StrList_reverse(StrList *list) {
   Node *current = list->_head;
   Node *next = NULL;
   Node *prev = NULL;
+  list->_tail = list->_head;
   while (current != NULL) {
+    // reverse the strings of the node
+    for (int i = 0, j = current->_count - 1; i < j; i++, j--) {
+      char *temp = current->_data[i];
+      current->_data[i] = current->_data[j];
+      current->_data[j] = temp;
+    }
+
+    // and the order of the nodes
     next = current->_next;
     current->_next = prev;
     prev = current;
@@ -340,50 +767,279 @@ void StrList_reverse(StrList *list) {
   }
 
   list->_head = prev;
+  Index_rebuild(list);
 }
 
 int StrList_isSorted(StrList *list) {
   if (list == NULL || list->_head == NULL) return 0;
-  Node *temp = list->_head;
 
-  if (temp == NULL) return 1;
-  while (temp->_next != NULL) {
-    if (strcmp(temp->_data, temp->_next->_data) > 0) {
-      return 0;
+  // compare every string with the one before it
+  const char *prev = list->_head->_data[0];
+  for (const Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    for (int i = 0; i < temp->_count; i++) {
+      if (strcmp(prev, temp->_data[i]) > 0) {
+        return 0;
+      }
+      prev = temp->_data[i];
     }
-    temp = temp->_next;
   }
   return 1;
 }
 
-void swapNodes(Node *a, Node *b) {
-  char *temp = a->_data;
-  a->_data = b->_data;
-  b->_data = temp;
+//------------------------------------------------
+// Sort
+//------------------------------------------------
+
+// the strings are sorted in runs of this many with insertion sort before
+// the merge passes
+#define SORT_RUN 16
+
+// from this many strings on the list is sorted with multikey quicksort on
+// the cached prefixes instead of the merge sort
+#define SORT_PREFIX_MIN 4096
+
+// a string and 8 of its chars from some depth on, packed so that comparing
+// the numbers is comparing the chars with strcmp (0 after the end)
+typedef struct {
+  uint64_t _prefix;
+  char *_data;
+} SortEntry;
+
+// copy the strings of the list to an array, in order
+void List_gather(const StrList *list, char **strings) {
+  size_t k = 0;
+  for (const Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    memcpy(strings + k, temp->_data, temp->_count * sizeof(char *));
+    k += temp->_count;
+  }
 }
 
-void bubbleSort(StrList *list) {
-  int swapped;
-  Node *ptr1;
-  Node *lptr = NULL;
+// put the strings of the array back in the nodes, in order (the nodes keep
+// their sizes, so the index stays the same)
+void List_scatter(StrList *list, char **strings) {
+  size_t k = 0;
+  for (Node *temp = list->_head; temp != NULL; temp = temp->_next) {
+    memcpy(temp->_data, strings + k, temp->_count * sizeof(char *));
+    k += temp->_count;
+  }
+}
 
-  if (list->_head == NULL) return;
+// stable merge of the sorted runs src[low..mid) and src[mid..high) to dst
+void mergeRuns(char **src, char **dst, size_t low, size_t mid, size_t high) {
+  size_t i = low;
+  size_t j = mid;
+  for (size_t k = low; k < high; k++) {
+    // the right one is taken only if it is smaller, so equal strings keep
+    // their order
+    if (j < high && (i == mid || strcmp(src[j], src[i]) < 0)) {
+      dst[k] = src[j++];
+    } else {
+      dst[k] = src[i++];
+    }
+  }
+}
+
+// stable bottom-up merge sort of n strings, temp has room for n strings
+void mergeSort(char **strings, char **temp, size_t n) {
+  // insertion sort of every run
+  for (size_t low = 0; low < n; low += SORT_RUN) {
+    size_t high = low + SORT_RUN < n ? low + SORT_RUN : n;
+    for (size_t i = low + 1; i < high; i++) {
+      char *data = strings[i];
+      size_t j = i;
+      while (j > low && strcmp(strings[j - 1], data) > 0) {
+        strings[j] = strings[j - 1];
+        j--;
+      }
+      strings[j] = data;
+    }
+  }
+
+  // merge pairs of runs, twice as long every pass, between the two arrays
+  char **src = strings;
+  char **dst = temp;
+  for (size_t width = SORT_RUN; width < n; width *= 2) {
+    for (size_t low = 0; low < n; low += 2 * width) {
+      size_t mid = low + width < n ? low + width : n;
+      size_t high = low + 2 * width < n ? low + 2 * width : n;
+      mergeRuns(src, dst, low, mid, high);
+    }
+    char **swap = src;
+    src = dst;
+    dst = swap;
+  }
+  if (src != strings) {
+    memcpy(strings, src, n * sizeof(char *));
+  }
+}
+
+// moves strings[root] down the max heap strings[0, n) to where it belongs
+void heapSift(char **strings, size_t root, size_t n) {
+  char *data = strings[root];
+  size_t child;
+  while ((child = 2 * root + 1) < n) {
+    if (child + 1 < n && strcmp(strings[child + 1], strings[child]) > 0) {
+      child++;
+    }
+    if (strcmp(strings[child], data) <= 0) break;
+    strings[root] = strings[child];
+    root = child;
+  }
+  strings[root] = data;
+}
+
+// heap sort, in place - for when there is no room for the merge sort's copy
+void heapSort(char **strings, size_t n) {
+  for (size_t root = n / 2; root > 0; root--) {
+    heapSift(strings, root - 1, n);
+  }
+  for (size_t end = n; end > 1; end--) {
+    char *largest = strings[0];
+    strings[0] = strings[end - 1];
+    strings[end - 1] = largest;
+    heapSift(strings, 0, end - 1);
+  }
+}
 
-  do {
-    swapped = 0;
-    ptr1 = list->_head;
+// the 8 chars of data from depth on, the first one in the highest byte
+// (data has at least depth chars)
+uint64_t loadPrefix(const char *data, size_t depth) {
+  uint64_t prefix = 0;
+  int k = 0;
+  for (; k < 8 && data[depth + k] != '\0'; k++) {
+    prefix = (prefix << 8) | (unsigned char)data[depth + k];
+  }
+  // the chars after the end are 0
+  return k == 0 ? 0 : prefix << (8 * (8 - k));
+}
 
-    while (ptr1->_next != lptr) {
-      if (strcmp(ptr1->_data, ptr1->_next->_data) > 0) {
-        swapNodes(ptr1, ptr1->_next);
-        swapped = 1;
+/*
+ * Multikey quicksort (Bentley & Sedgewick) with 8 chars at a time: the
+ * entries are split by their prefix into smaller, equal and bigger ones, and
+ * only the equal ones go on to the next 8 chars. Most compares are of the
+ * cached numbers, without going to the strings. All the entries have the same
+ * first depth chars.
+ */
+void prefixSort(SortEntry *entries, size_t n, size_t depth) {
+  while (n > SORT_RUN) {
+    // the median of the first, middle and last prefix is the pivot
+    uint64_t a = entries[0]._prefix;
+    uint64_t b = entries[n / 2]._prefix;
+    uint64_t c = entries[n - 1]._prefix;
+    uint64_t pivot = a < b ? (b < c ? b : (a < c ? c : a))
+                           : (a < c ? a : (b < c ? c : b));
+
+    // [0, lt) smaller, [lt, i) equal, [gt, n) bigger
+    size_t lt = 0;
+    size_t i = 0;
+    size_t gt = n;
+    while (i < gt) {
+      SortEntry entry = entries[i];
+      if (entry._prefix < pivot) {
+        entries[i++] = entries[lt];
+        entries[lt++] = entry;
+      } else if (entry._prefix > pivot) {
+        entries[i] = entries[--gt];
+        entries[gt] = entry;
+      } else {
+        i++;
       }
-      ptr1 = ptr1->_next;
     }
-    lptr = ptr1;
-  } while (swapped);
+
+    // the equal ones are the same strings if they ended in these 8 chars,
+    // else they are sorted by the next 8 chars
+    size_t less = lt;
+    size_t equal = 0;
+    size_t more = n - gt;
+    if ((pivot & 0xff) != 0) {
+      for (size_t k = lt; k < gt; k++) {
+        entries[k]._prefix = loadPrefix(entries[k]._data, depth + 8);
+      }
+      equal = gt - lt;
+    }
+
+    // the two smaller parts are sorted first and the loop goes on with the
+    // biggest, so the calls nest at most log n deep however long the common
+    // prefixes are
+    if (equal >= less && equal >= more) {
+      prefixSort(entries, less, depth);
+      prefixSort(entries + gt, more, depth);
+      entries += lt;
+      n = equal;
+      depth += 8;
+    } else if (less >= more) {
+      prefixSort(entries + lt, equal, depth + 8);
+      prefixSort(entries + gt, more, depth);
+      n = less;
+    } else {
+      prefixSort(entries, less, depth);
+      prefixSort(entries + lt, equal, depth + 8);
+      entries += gt;
+      n = more;
+    }
+  }
+
+  // a few entries - insertion sort, by the prefix and then the rest of the
+  // strings
+  for (size_t i = 1; i < n; i++) {
+    SortEntry entry = entries[i];
+    size_t j = i;
+    while (j > 0 &&
+           (entries[j - 1]._prefix > entry._prefix ||
+            (entries[j - 1]._prefix == entry._prefix &&
+             (entry._prefix & 0xff) != 0 &&
+             strcmp(entries[j - 1]._data + depth + 8,
+                    entry._data + depth + 8) > 0))) {
+      entries[j] = entries[j - 1];
+      j--;
+    }
+    entries[j] = entry;
+  }
 }
+
 void StrList_sort(StrList *list) {
   if (list == NULL || list->_head == NULL) return;
-  bubbleSort(list);
-}
\ No newline at end of file
+  size_t n = list->_size;
+
+  // a big list - multikey quicksort on the cached prefixes
+  if (n >= SORT_PREFIX_MIN) {
+    SortEntry *entries = (SortEntry *)malloc(n * sizeof(SortEntry));
+    char **strings = (char **)malloc(n * sizeof(char *));
+    if (entries != NULL && strings != NULL) {
+      List_gather(list, strings);
+      for (size_t k = 0; k < n; k++) {
+        entries[k]._data = strings[k];
+        entries[k]._prefix = loadPrefix(strings[k], 0);
+      }
+      prefixSort(entries, n, 0);
+      for (size_t k = 0; k < n; k++) {
+        strings[k] = entries[k]._data;
+      }
+      List_scatter(list, strings);
+      free(entries);
+      free(strings);
+      return;
+    }
+    free(entries);
+    free(strings);
+  }
+
+  // the strings are sorted in an array with the merge sort and put back
+  char **strings = (char **)malloc(2 * n * sizeof(char *));
+  if (strings != NULL) {
+    List_gather(list, strings);
+    mergeSort(strings, strings + n, n);
+    List_scatter(list, strings);
+    free(strings);
+    return;
+  }
+
+  // no room for the copy - a heap sort in half the memory, and if there is
+  // not even that the list is left as it is
+  strings = (char **)malloc(n * sizeof(char *));
+  if (strings == NULL) return;
+  List_gather(list, strings);
+  heapSort(strings, n);
+  List_scatter(list, strings);
+  free(strings);
+}
@@ -34,6 +34,14 @@ StrList *StrList_alloc();
  */
 void StrList_free(StrList *StrList);
 
+/*
+ * Removes all the elements of the StrList in constant time, apart from freeing
+ * the few regions of big strings (one per string over a quarter of a region).
+ * The rest of the memory of the elements is kept for the ones inserted next,
+ * and is freed by StrList_free.
+ */
+void StrList_clear(StrList *StrList);
+
 /*
  * Returns the number of elements in the StrList.
  */